@@ -0,0 +1,75 @@
+// The allocators in harness/memory.h on schedules that allocate inside
+// inner loops.
+//
+//   bench/allocators [-p interpolate|bilateral_grid|blur] [-l levels]
+//                    [-N size] [-t trials] [-s schedule]
+//
+// Builds the pipeline once per allocator under the same schedule and
+// prints one JSON line each: "counting" (the system allocator, counted),
+// "retaining" (freed blocks kept by size, behind a lock) and "pooled"
+// (per-thread size classes). "allocs" is allocations per realization,
+// "reused" how many of them were served from kept blocks, "alloc_rate"
+// allocations per second, and "speedup" is against counting.
+//
+// The default schedule for interpolate is "inner" (see
+// bench/interpolate_schedules.h), which like the test cases' simplest
+// schedules allocates downx and upsampledx once per pixel; other
+// schedules are as in bench/scheduled.h.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, trials = 5;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:N:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: allocators [-p interpolate|bilateral_grid|blur] [-l levels] [-N size] [-t trials]\n"
+                            "                  [-s schedule]\n");
+            return 2;
+        }
+    }
+    if (which.empty() && name == "interpolate") which = "inner";
+
+    const char *names[] = {"counting", "retaining", "pooled"};
+    const autotune::Allocator allocators[] = {autotune::Counting, autotune::Retaining, autotune::Pooled};
+    double base = 0;
+    for (int a = 0; a < 3; a++) {
+        pipelines::Pipeline p;
+        if (!build_scheduled(name, levels, false, which, p)) {
+            fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+            return 1;
+        }
+        if (size.empty()) size = p.size;
+        autotune::compile(p.output, allocators[a]);
+        Buffer output = autotune::bind(p.output, size);
+        autotune::Result r = autotune::measure(p.output, output, trials);
+        if (a == 0) base = r.time;
+        printf("{\"allocator\": \"%s\", \"time\": %.10f, \"allocs\": %zu, \"reused\": %zu, \"alloc_rate\": %.0f, "
+               "\"peak_mem\": %zu, \"speedup\": %.4f}\n",
+               names[a], r.time, r.allocs, autotune::alloc_stats().reused.load(), r.time > 0 ? r.allocs / r.time : 0,
+               r.peak_mem, base / r.time);
+        fflush(stdout);
+        autotune::release_retained();
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Frames back to back with and without keeping allocations between them
+// (harness/batch.h).
+//
+//   bench/batch [-p interpolate|bilateral_grid|blur] [-l levels]
+//               [-f frames] [-d depth,...] [-N size] [-s schedule]
+//
+// For each pipelining depth (default 1: frames back to back) runs -f
+// frames (default 100) twice: with the counting allocator, which frees
+// the intermediates after every frame, and with the retaining one, which
+// keeps them for the next. Output buffers are allocated once either way.
+// One JSON line per run: median, 90th and 99th percentile and worst
+// frame latency, the first frame's latency, steady-state throughput, and
+// the allocations and page faults per frame that the retained run saves.
+//
+// -s names a schedule, or a schedule file, as in bench/scheduled.h.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/batch.h"
+#include "harness/harness.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, frames = 100;
+    std::vector<int> size, depths(1, 1);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:f:d:N:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'f': frames = atoi(optarg); break;
+        case 'd': depths = autotune::parse_size(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: batch [-p interpolate|bilateral_grid|blur] [-l levels] [-f frames] [-d depth,...]\n"
+                            "             [-N size] [-s schedule]\n");
+            return 2;
+        }
+    }
+
+    for (size_t d = 0; d < depths.size(); d++) {
+        int depth = depths[d] < 1 ? 1 : depths[d];
+        for (int retain = 0; retain < 2; retain++) {
+            std::vector<pipelines::Pipeline> builds(depth);
+            std::vector<Func> funcs;
+            for (int i = 0; i < depth; i++) {
+                if (!build_scheduled(name, levels, false, which, builds[i])) {
+                    fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+                    return 1;
+                }
+                funcs.push_back(builds[i].output);
+                autotune::compile(funcs.back(), retain ? autotune::Retaining : autotune::Counting);
+            }
+            if (size.empty()) size = builds[0].size;
+
+            // Every build reads the inputs bound for the first, into an
+            // output of its own
+            std::vector<Buffer> outputs(1, autotune::bind(funcs[0], size));
+            std::vector<Internal::Parameter> inputs = autotune::find_input_params(funcs[0]);
+            const buffer_t *o = outputs[0].raw_buffer();
+            for (int i = 1; i < depth; i++) {
+                std::vector<Internal::Parameter> params = autotune::find_input_params(funcs[i]);
+                for (size_t k = 0; k < params.size() && k < inputs.size(); k++) params[k].set_buffer(inputs[k].get_buffer());
+                outputs.push_back(Buffer(outputs[0].type(), o->extent[0], o->extent[1], o->extent[2], o->extent[3]));
+            }
+
+            autotune::BatchResult r = autotune::run_batch(funcs, outputs, frames);
+            printf("{\"pipeline\": \"%s\", \"alloc\": \"%s\", \"depth\": %d, \"frames\": %d, \"p50\": %.10f, "
+                   "\"p90\": %.10f, \"p99\": %.10f, \"max\": %.10f, \"first\": %.10f, \"throughput\": %.4f, "
+                   "\"allocs_per_frame\": %.2f, \"faults_per_frame\": %.2f, \"peak_mem\": %zu}\n",
+                   name.c_str(), retain ? "retained" : "fresh", depth, frames, autotune::median(r.latencies),
+                   autotune::percentile(r.latencies, 0.9), autotune::percentile(r.latencies, 0.99),
+                   autotune::percentile(r.latencies, 1), r.first, r.wall > 0 ? frames / r.wall : 0, r.allocs,
+                   r.faults, r.peak_mem);
+            fflush(stdout);
+            autotune::release_retained();
+        }
+    }
+    return 0;
+}
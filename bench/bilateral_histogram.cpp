@@ -0,0 +1,99 @@
+// How the bilateral grid's histogram scales with threads.
+//
+//   bench/bilateral_histogram [-N size] [-t trials] [-j threads,...]
+//
+// Three versions, each timed at every thread count (0 = Halide's
+// default) with harness/configs.h:
+//
+//   root     the test cases' algorithm with every Func at root: the
+//            histogram's scatter runs on one core
+//   classic  the test cases' CPU schedule: the histogram computed per
+//            grid column inside grid's parallel y loop
+//   tiled    the tiled variant (pipelines/bilateral_grid.h): private
+//            per-row histograms computed per tile of 8 grid rows, summed
+//            by a pure histogram whose y tiles run in parallel
+//
+// One JSON line per version and thread count, then the largest
+// difference of each version's output from root's.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/bilateral_schedules.h"
+#include "harness/configs.h"
+#include "harness/harness.h"
+#include "pipelines/bilateral_grid.h"
+
+using namespace Halide;
+
+static pipelines::BilateralGrid make(const std::string &version) {
+    pipelines::BilateralGrid p = pipelines::make_bilateral_grid(4, 0.1f, version == "tiled");
+    schedule_bilateral(p, version);
+    return p;
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> size, threads;
+    int trials = 5;
+    threads.push_back(1);
+    threads.push_back(0);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "N:t:j:")) != -1) {
+        switch (opt) {
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 'j': threads = autotune::parse_size(optarg); break;
+        default:
+            fprintf(stderr, "usage: bilateral_histogram [-N size] [-t trials] [-j threads,...]\n");
+            return 2;
+        }
+    }
+
+    const char *versions[] = {"root", "classic", "tiled"};
+    std::vector<pipelines::BilateralGrid> pipelines;
+    for (int v = 0; v < 3; v++) {
+        pipelines.push_back(make(versions[v]));
+        if (size.empty()) size = pipelines.back().size;
+    }
+    std::vector<autotune::Config> configs;
+    for (size_t i = 0; i < threads.size(); i++) {
+        autotune::Config c;
+        c.size = size;
+        c.threads = threads[i];
+        c.weight = 1;
+        configs.push_back(c);
+    }
+
+    // Every measurement runs in forked children before anything is
+    // realized here, which would start this process's thread pool
+    for (int v = 0; v < 3; v++) {
+        autotune::compile(pipelines[v].output);
+        std::vector<autotune::ConfigResult> results =
+            autotune::measure_configs(pipelines[v].output, configs, trials);
+        for (size_t i = 0; i < configs.size(); i++) {
+            const autotune::Result &r = results[i].result;
+            printf("{\"version\": \"%s\", \"threads\": %d, \"ok\": %d, \"time\": %.10f, \"peak_mem\": %zu}\n",
+                   versions[v], configs[i].threads, results[i].ok ? 1 : 0, r.time, r.peak_mem);
+            fflush(stdout);
+        }
+    }
+
+    std::vector<Buffer> outputs;
+    for (int v = 0; v < 3; v++) {
+        outputs.push_back(autotune::bind(pipelines[v].output, size));
+        pipelines[v].output.realize(outputs.back());
+    }
+    for (int v = 1; v < 3; v++) {
+        // -1 for outputs that don't match at all (see max_difference)
+        double diff = autotune::max_difference(outputs[0], outputs[v]);
+        printf("{\"version\": \"%s\", \"max_diff\": %g}\n", versions[v], isinf(diff) ? -1 : diff);
+    }
+    return 0;
+}
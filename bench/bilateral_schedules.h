@@ -0,0 +1,54 @@
+#ifndef BENCH_BILATERAL_SCHEDULES_H
+#define BENCH_BILATERAL_SCHEDULES_H
+
+// Schedules the bilateral grid benchmarks choose from by name.
+
+#include <Halide.h>
+
+#include <random>
+#include <string>
+
+#include "pipelines/bilateral_grid.h"
+#include "search/apply.h"
+#include "search/evolve.h"
+
+// The test cases' CPU schedule for the blurs and the output
+inline void schedule_bilateral_blurs(pipelines::BilateralGrid &p) {
+    using Halide::Var;
+    Var x = p.x, y = p.y, z = p.z;
+    p.blurx.compute_root().parallel(z).vectorize(x, 4);
+    p.blury.compute_root().parallel(z).vectorize(x, 4);
+    p.blurz.compute_root().parallel(z).vectorize(x, 4);
+    p.bilateral_grid.compute_root().parallel(y).vectorize(x, 4);
+}
+
+// "root" computes every Func at root; "classic" is the test cases' CPU
+// schedule, the histogram computed per grid column inside grid's
+// parallel y loop; "tiled" (tiled variant only) computes the private row
+// histograms per tile of 8 grid rows and runs the tiles in parallel.
+// Anything else is a file for search::load_schedule. Returns false if
+// the file has no schedule.
+inline bool schedule_bilateral(pipelines::BilateralGrid &p, const std::string &which) {
+    using Halide::Var;
+    Var x = p.x, y = p.y, z = p.z, c = p.c, yi("yi");
+    if (which == "root") {
+        std::mt19937 rng(0);
+        search::PipelineInfo info = search::describe(p);
+        search::apply(search::Operators(info, rng).root_schedule(), p);
+    } else if (which == "classic") {
+        p.grid.compute_root().reorder(c, z, x, y).parallel(y);
+        p.histogram.compute_at(p.grid, x).unroll(c);
+        schedule_bilateral_blurs(p);
+    } else if (which == "tiled") {
+        p.histogram.compute_root().split(y, y, yi, 8).parallel(y).vectorize(x, 4);
+        p.histogram_rows.compute_at(p.histogram, y);
+        schedule_bilateral_blurs(p);
+    } else {
+        search::Schedule s;
+        if (!search::load_schedule(which, s)) return false;
+        search::apply(s, p);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,120 @@
+// The uint16 blur of the test cases against its fixed-point variant.
+//
+//   bench/blur_fixed [-N size] [-t trials] [-s root|tiled|schedule.txt]
+//
+// First checks div3 (pipelines/blur.h) exhaustively: every sum of three
+// uint16 values, divided in a vectorized Halide Func, against sum / 3.
+// Then times both blurs under the same schedule (root, tiled or a file,
+// see bench/blur_schedules.h), since both have the same Funcs. Each
+// output is compared with a plain C++ blur in exact arithmetic; "errors"
+// counts the pixels that differ. The test cases' blur is also compared
+// with a C++ blur that wraps the same way, which it should match
+// exactly.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench/blur_schedules.h"
+#include "harness/harness.h"
+#include "pipelines/blur.h"
+
+using namespace Halide;
+
+// Number of sums in [0, 3 * 65535] that div3 gets wrong
+static size_t check_div3() {
+    const int n = 3 * 65535 + 1;
+    Var x("x");
+    Func f("div3");
+    f(x) = pipelines::div3(cast<uint32_t>(x));
+    f.vectorize(x, 8);
+    Buffer out(UInt(16), n);
+    f.realize(out);
+    const uint16_t *q = (const uint16_t *)out.host_ptr();
+    size_t errors = 0;
+    for (int s = 0; s < n; s++) {
+        if (q[s] != s / 3) errors++;
+    }
+    return errors;
+}
+
+// The blur in C++ of the input in at output (x, y). wrap
+// adds in uint16 like the test cases.
+static uint16_t reference(const buffer_t *in, int x, int y, bool wrap) {
+    int w = in->extent[0], h = in->extent[1];
+    uint32_t rows[3];
+    for (int j = 0; j < 3; j++) {
+        uint32_t sum = 0;
+        for (int i = 0; i < 3; i++) {
+            // input(x, y) = in_img(clamp(x, 1, w-1), clamp(y, 1, h)-1)
+            int cx = std::min(std::max(x + i, 1), w - 1), cy = std::min(std::max(y + j, 1), h) - 1;
+            sum += ((const uint16_t *)in->host)[(cx - in->min[0]) * in->stride[0] + (cy - in->min[1]) * in->stride[1]];
+            if (wrap) sum = (uint16_t)sum;
+        }
+        rows[j] = sum / 3;
+    }
+    uint32_t sum = 0;
+    for (int j = 0; j < 3; j++) {
+        sum += rows[j];
+        if (wrap) sum = (uint16_t)sum;
+    }
+    return (uint16_t)(sum / 3);
+}
+
+static size_t count_errors(pipelines::Blur &p, Buffer output, bool wrap) {
+    const buffer_t *in = p.in_img.get().raw_buffer(), *out = output.raw_buffer();
+    size_t errors = 0;
+    for (int y = 0; y < out->extent[1]; y++) {
+        for (int x = 0; x < out->extent[0]; x++) {
+            uint16_t v = ((const uint16_t *)out->host)[x * out->stride[0] + y * out->stride[1]];
+            if (v != reference(in, out->min[0] + x, out->min[1] + y, wrap)) errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> size;
+    int trials = 10;
+    std::string which = "tiled";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "N:t:s:")) != -1) {
+        switch (opt) {
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: blur_fixed [-N size] [-t trials] [-s root|tiled|schedule.txt]\n");
+            return 2;
+        }
+    }
+
+    size_t div3_errors = check_div3();
+    printf("{\"div3_checked\": %d, \"div3_errors\": %zu}\n", 3 * 65535 + 1, div3_errors);
+    fflush(stdout);
+    if (div3_errors) return 1;
+
+    const char *names[] = {"blur", "blur_fixed"};
+    for (int v = 0; v < 2; v++) {
+        pipelines::Blur p = pipelines::make_blur(v == 1);
+        if (size.empty()) size = p.size;
+        if (!schedule_blur(p, which)) {
+            fprintf(stderr, "can't read a schedule from %s\n", which.c_str());
+            return 1;
+        }
+        Buffer output = autotune::prepare(p.output, size);
+        autotune::Result r = autotune::measure(p.output, output, trials);
+        printf("{\"pipeline\": \"%s\", \"time\": %.10f, \"peak_mem\": %zu, \"errors\": %zu",
+               names[v], r.time, r.peak_mem, count_errors(p, output, false));
+        if (v == 0) printf(", \"wrap_errors\": %zu", count_errors(p, output, true));
+        printf("}\n");
+        fflush(stdout);
+    }
+    return 0;
+}
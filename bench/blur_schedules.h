@@ -0,0 +1,38 @@
+#ifndef BENCH_BLUR_SCHEDULES_H
+#define BENCH_BLUR_SCHEDULES_H
+
+// Schedules the blur benchmarks choose from by name.
+
+#include <Halide.h>
+
+#include <random>
+#include <string>
+
+#include "pipelines/blur.h"
+#include "search/apply.h"
+#include "search/evolve.h"
+
+// "root" computes every Func at root, "tiled" runs strips of 8 rows of
+// blur_y in parallel with blur_x computed per strip, both vectorized by
+// 8, and anything else is a file for search::load_schedule (a test case
+// such as old/halideerror.cpp, or a schedule from search/tune -p blur).
+// Returns false if the file has no schedule.
+inline bool schedule_blur(pipelines::Blur &p, const std::string &which) {
+    using Halide::Var;
+    Var x = p.x, y = p.y, yi("yi");
+    if (which == "root") {
+        std::mt19937 rng(0);
+        search::PipelineInfo info = search::describe(p);
+        search::apply(search::Operators(info, rng).root_schedule(), p);
+    } else if (which == "tiled") {
+        p.blur_y.compute_root().split(y, y, yi, 8).parallel(y).vectorize(x, 8);
+        p.blur_x.compute_at(p.blur_y, y).vectorize(x, 8);
+    } else {
+        search::Schedule s;
+        if (!search::load_schedule(which, s)) return false;
+        search::apply(s, p);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,114 @@
+// Clamped loads against a pre-padded input.
+//
+//   bench/boundary [-p interpolate|bilateral_grid|blur] [-l levels]
+//                  [-N size] [-t trials] [-s schedule]
+//
+// Every load of the input clamps both coordinates to the image in the
+// test cases' algorithms, which costs two mins and two maxes per load
+// and turns the innermost x loads into gathers. The _padded variants
+// read the input unclamped, from a buffer bound with the pipeline's
+// halo already filled by edge replication (autotune::pad_from).
+//
+// Both variants run under the same schedule (interpolate: flat, root or
+// a file; bilateral_grid: classic, root or a file; blur: tiled, root or
+// a file), on the same image: the padded input is filled from the
+// clamped variant's. Prints one JSON line each for the clamped variant,
+// the padding itself (what producing a padded frame from an unpadded
+// one costs, if capture can't write into the padded buffer directly)
+// and the padded variant, then the speedup and the largest difference
+// between the outputs.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/stats.h"
+#include "pipelines/pipelines.h"
+
+using namespace Halide;
+
+// One variant of a pipeline, scheduled
+struct Variant {
+    pipelines::Pipeline p;
+    Internal::Parameter input;
+};
+
+static bool build(const std::string &name, int levels, bool padded, const std::string &which, Variant &v) {
+    if (!build_scheduled(name, levels, padded, which, v.p)) return false;
+    v.input = autotune::find_input_params(v.p.output)[0];
+    return true;
+}
+
+static void print_line(const char *boundary, const autotune::Result &r) {
+    printf("{\"boundary\": \"%s\", \"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu}\n",
+           boundary, r.time, r.peak_mem, r.allocs);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, trials = 5;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:N:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: boundary [-p interpolate|bilateral_grid|blur] [-l levels] [-N size] [-t trials]\n"
+                            "                [-s schedule]\n");
+            return 2;
+        }
+    }
+
+    Variant clamped, padded;
+    if (!build(name, levels, false, which, clamped) || !build(name, levels, true, which, padded)) {
+        fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+        return 1;
+    }
+    if (size.empty()) size = clamped.p.size;
+
+    Buffer clamped_out = autotune::prepare(clamped.p.output, size);
+    Buffer padded_out = autotune::prepare(padded.p.output, size);
+    Buffer image = clamped.input.get_buffer(), padded_in = padded.input.get_buffer();
+
+    // The image proper is what the clamps clamp to: [0, w-1] x [0, h-1]
+    // of the clamped input, except for blur's off by one columns
+    std::vector<int> lo(2, 0), hi(2);
+    if (name == "blur") lo[0] = 1;
+    hi[0] = image.raw_buffer()->extent[0] - 1;
+    hi[1] = image.raw_buffer()->extent[1] - 1;
+
+    autotune::Result c = autotune::measure(clamped.p.output, clamped_out, trials);
+    print_line("clamped", c);
+
+    autotune::Result pad;
+    pad.peak_mem = pad.allocs = pad.max_rss = 0;
+    for (int i = 0; i < trials; i++) {
+        double t1 = autotune::now();
+        autotune::pad_from(padded_in, image, lo, hi);
+        pad.samples.push_back(autotune::now() - t1);
+    }
+    pad.time = autotune::minimum(pad.samples);
+    print_line("pad", pad);
+
+    autotune::Result r = autotune::measure(padded.p.output, padded_out, trials);
+    print_line("padded", r);
+
+    // -1 for outputs that don't match at all (see max_difference)
+    double diff = autotune::max_difference(clamped_out, padded_out);
+    printf("{\"pipeline\": \"%s\", \"speedup\": %.4f, \"speedup_with_pad\": %.4f, \"max_diff\": %g}\n",
+           name.c_str(), c.time / r.time, c.time / (r.time + pad.time), isinf(diff) ? -1 : diff);
+    return 0;
+}
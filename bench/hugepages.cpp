@@ -0,0 +1,110 @@
+// Huge pages for large intermediates (harness/hugepages.h), before and
+// after, per schedule.
+//
+//   bench/hugepages [-p interpolate|bilateral_grid|blur] [-l levels]
+//                   [-s schedule,schedule...] [-T threshold_kb] [-N size]
+//                   [-t trials]
+//
+// Builds the pipeline under each schedule once per backing and prints
+// one JSON line each: "small" (counting_malloc, the system's pages),
+// "transparent" (madvise(MADV_HUGEPAGE)) and "hugetlb" (MAP_HUGETLB,
+// falling back to transparent huge pages without reserved ones).
+// "dtlb_load_misses" and "dtlb_store_misses" are per realization, and -1
+// where perf can't count them; "huge_fraction" is the share of the large
+// blocks' bytes the kernel actually backed with huge pages, looked up in
+// an untimed realization, and "speedup" is against small pages under the
+// same schedule. Blocks of -T KB and more (default 2048) get huge pages.
+//
+// Schedules as in bench/scheduled.h, comma separated, e.g. tuned
+// schedule files. For interpolate the default is "flat,transposed": the
+// same schedule with row-major storage and with reorder_storage(c, y, x)
+// (bench/interpolate_schedules.h), whose row-order loops stride a whole
+// column between neighbouring pixels.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/hugepages.h"
+#include "harness/perf.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", list;
+    int levels = 3, trials = 10;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:s:T:N:t:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 's': list = optarg; break;
+        case 'T': autotune::huge_threshold() = (size_t)atol(optarg) * 1024; break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: hugepages [-p interpolate|bilateral_grid|blur] [-l levels] [-s schedule,schedule...]\n"
+                            "                 [-T threshold_kb] [-N size] [-t trials]\n");
+            return 2;
+        }
+    }
+    if (list.empty()) list = name == "interpolate" ? "flat,transposed" : "";
+    std::vector<std::string> schedules;
+    for (size_t b = 0, e; b <= list.size(); b = e + 1) {
+        e = list.find(',', b);
+        if (e == std::string::npos) e = list.size();
+        schedules.push_back(list.substr(b, e - b));
+    }
+
+    // Before the first realization starts the thread pool, so its
+    // workers inherit the counters
+    int loads = autotune::open_cache_counter(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                             PERF_COUNT_HW_CACHE_RESULT_MISS);
+    int stores = autotune::open_cache_counter(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_WRITE,
+                                              PERF_COUNT_HW_CACHE_RESULT_MISS);
+
+    const char *names[] = {"small", "transparent", "hugetlb"};
+    for (size_t s = 0; s < schedules.size(); s++) {
+        double base = 0;
+        for (int v = 0; v < 3; v++) {
+            pipelines::Pipeline p;
+            if (!build_scheduled(name, levels, false, schedules[s], p)) {
+                fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), schedules[s].c_str());
+                return 1;
+            }
+            if (size.empty()) size = p.size;
+            autotune::huge_page_mode() = v == 2 ? autotune::HugeTLB : autotune::Transparent;
+            autotune::compile(p.output, v == 0 ? autotune::Counting : autotune::HugePages);
+            Buffer output = autotune::bind(p.output, size);
+
+            autotune::reset_huge_stats();
+            autotune::huge_check() = v > 0;
+            autotune::realize_once(p.output, output);
+            autotune::huge_check() = false;
+            autotune::HugeStats &h = autotune::huge_stats();
+            double huge_fraction = h.checked ? (double)h.huge_bytes / h.checked : 0;
+
+            long long l0 = autotune::read_counter(loads), s0 = autotune::read_counter(stores);
+            autotune::Result r = autotune::measure(p.output, output, trials);
+            long long l1 = autotune::read_counter(loads), s1 = autotune::read_counter(stores);
+            if (v == 0) base = r.time;
+            printf("{\"schedule\": \"%s\", \"pages\": \"%s\", \"time\": %.10f, \"speedup\": %.4f, "
+                   "\"dtlb_load_misses\": %.0f, \"dtlb_store_misses\": %.0f, \"huge_fraction\": %.4f, "
+                   "\"hugetlb_fallbacks\": %zu, \"peak_mem\": %zu}\n",
+                   schedules[s].c_str(), names[v], r.time, base / r.time,
+                   l0 >= 0 && l1 >= 0 ? (double)(l1 - l0) / trials : -1,
+                   s0 >= 0 && s1 >= 0 ? (double)(s1 - s0) / trials : -1, huge_fraction, h.fallbacks.load(),
+                   r.peak_mem);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
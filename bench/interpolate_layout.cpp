@@ -0,0 +1,146 @@
+// Planar versus interleaved RGBA input for the interpolate pyramid.
+//
+//   bench/interpolate_layout [-l levels] [-N size] [-t trials]
+//                            [-s schedule] [-r schedule]
+//
+// Frames arrive from capture as interleaved RGBA. Feeding the planar
+// pipeline means transposing each frame first; the interleaved variant
+// (pipelines::make_interpolate(levels, true)) reads the frame as it is.
+// Prints one JSON line each for the planar pipeline, the interleaved to
+// planar transpose it needs, and the interleaved pipeline, then a
+// summary: "speedup" is (planar + transpose) / interleaved.
+//
+// Both pipelines get the same image (the planar input, transposed), and
+// "max_diff" and "mismatches" (elements off by more than 1e-4) check
+// that they compute the same output. -s schedules both: root, flat or a
+// file (bench/interpolate_schedules.h); flat is channel-innermost and
+// vectorized across channels. -r overrides it for the interleaved
+// pipeline, e.g. with a schedule from search/tune -p interpolate_rgba.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/interpolate_schedules.h"
+#include "harness/harness.h"
+#include "harness/stats.h"
+#include "pipelines/interpolate.h"
+
+using namespace Halide;
+
+// Copy a 3-dimensional float image between buffers of different layouts.
+// from_dims maps each dimension of src to the dimension of dst it is
+// stored along.
+static void copy_permuted(const buffer_t *src, buffer_t *dst, const int from_dims[3]) {
+    const float *in = (const float *)src->host;
+    float *out = (float *)dst->host;
+    int dst_stride[3];
+    for (int i = 0; i < 3; i++) dst_stride[i] = dst->stride[from_dims[i]];
+    for (int k = 0; k < src->extent[2]; k++) {
+        for (int j = 0; j < src->extent[1]; j++) {
+            const float *row = in + (size_t)k * src->stride[2] + (size_t)j * src->stride[1];
+            float *to = out + (size_t)k * dst_stride[2] + (size_t)j * dst_stride[1];
+            for (int i = 0; i < src->extent[0]; i++) {
+                to[(size_t)i * dst_stride[0]] = row[(size_t)i * src->stride[0]];
+            }
+        }
+    }
+}
+
+static void print_line(const char *layout, const autotune::Result &r) {
+    printf("{\"layout\": \"%s\", \"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu}\n",
+           layout, r.time, r.peak_mem, r.allocs);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    int levels = 3, trials = 5;
+    std::vector<int> size;
+    std::string planar_schedule = "flat", rgba_schedule;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:N:t:s:r:")) != -1) {
+        switch (opt) {
+        case 'l': levels = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': planar_schedule = optarg; break;
+        case 'r': rgba_schedule = optarg; break;
+        default:
+            fprintf(stderr, "usage: interpolate_layout [-l levels] [-N size] [-t trials] [-s schedule] [-r schedule]\n");
+            return 2;
+        }
+    }
+    if (rgba_schedule.empty()) rgba_schedule = planar_schedule;
+
+    pipelines::Interpolate planar = pipelines::make_interpolate(levels);
+    pipelines::Interpolate rgba = pipelines::make_interpolate(levels, true);
+    if (size.empty()) size = planar.size;
+    if (!schedule_interpolate(planar, planar_schedule)) {
+        fprintf(stderr, "can't read a schedule from %s\n", planar_schedule.c_str());
+        return 1;
+    }
+    if (!schedule_interpolate(rgba, rgba_schedule)) {
+        fprintf(stderr, "can't read a schedule from %s\n", rgba_schedule.c_str());
+        return 1;
+    }
+
+    Buffer planar_out = autotune::prepare(planar.output, size);
+    Buffer rgba_out = autotune::prepare(rgba.output, size);
+    buffer_t *planar_in = planar.input.get().raw_buffer();
+    buffer_t *rgba_in = rgba.input.get().raw_buffer();
+    if (planar_in->extent[0] != rgba_in->extent[1] || planar_in->extent[1] != rgba_in->extent[2] ||
+        planar_in->extent[2] != rgba_in->extent[0]) {
+        fprintf(stderr, "inputs of the two layouts don't match\n");
+        return 1;
+    }
+
+    // The same image for both: (x, y, c) -> (c, x, y)
+    const int to_interleaved[3] = {1, 2, 0};
+    copy_permuted(planar_in, rgba_in, to_interleaved);
+
+    autotune::Result p = autotune::measure(planar.output, planar_out, trials);
+    print_line("planar", p);
+
+    // What feeding an RGBA frame to the planar pipeline costs on top:
+    // (c, x, y) -> (x, y, c)
+    const int to_planar[3] = {2, 0, 1};
+    autotune::Result t;
+    t.peak_mem = t.allocs = t.max_rss = 0;
+    for (int i = 0; i < trials; i++) {
+        double t1 = autotune::now();
+        copy_permuted(rgba_in, planar_in, to_planar);
+        t.samples.push_back(autotune::now() - t1);
+    }
+    t.time = autotune::minimum(t.samples);
+    print_line("transpose", t);
+
+    autotune::Result r = autotune::measure(rgba.output, rgba_out, trials);
+    print_line("interleaved", r);
+
+    const buffer_t *a = planar_out.raw_buffer(), *b = rgba_out.raw_buffer();
+    double max_diff = 0;
+    size_t mismatches = 0;
+    for (int c = 0; c < a->extent[2]; c++) {
+        for (int y = 0; y < a->extent[1]; y++) {
+            for (int x = 0; x < a->extent[0]; x++) {
+                float u = ((const float *)a->host)[x * a->stride[0] + y * a->stride[1] + c * a->stride[2]];
+                float v = ((const float *)b->host)[x * b->stride[0] + y * b->stride[1] + c * b->stride[2]];
+                if (u != u && v != v) continue;  // both divided by zero alpha
+                double d = fabs((double)u - v);
+                if (!(d <= 1e-4)) mismatches++;  // NaN counts too
+                if (d > max_diff) max_diff = d;
+            }
+        }
+    }
+
+    printf("{\"levels\": %d, \"speedup\": %.4f, \"transpose_share\": %.4f, \"max_diff\": %g, "
+           "\"mismatches\": %zu}\n",
+           levels, (p.time + t.time) / r.time, t.time / (p.time + t.time), max_diff, mismatches);
+    return 0;
+}
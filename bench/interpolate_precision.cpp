@@ -0,0 +1,118 @@
+// float32 against normalized uint16 storage for the interpolate pyramid.
+//
+//   bench/interpolate_precision [-l levels] [-N size] [-t trials]
+//                               [-s schedule] [-i image]
+//
+// The unorm16 variant (pipelines::make_interpolate(levels, false, false,
+// true)) stores every intermediate level as uint16 and computes in
+// float32. Both variants run under the same schedule (root, flat or a
+// file, see bench/interpolate_schedules.h) on the same image, and print
+// one JSON line each: "alloc_bytes" is what one realization allocates,
+// which for intermediates computed at root is also what it writes and
+// reads back. The summary line has the speedup, the memory saved and the
+// accuracy of the unorm16 output against the float32 one: largest
+// absolute error, RMS error and PSNR (peak 1) over the pixels that are
+// finite in both, and "nan_mismatches", the pixels that are NaN (zero
+// alpha) in one output only. -i reads the input from a raw planar RGBA
+// float file of the given size, or an RGB PFM file of it, instead
+// (harness/images.h), to measure the error on a real photograph.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/interpolate_schedules.h"
+#include "harness/harness.h"
+#include "harness/images.h"
+#include "pipelines/interpolate.h"
+
+using namespace Halide;
+
+struct Accuracy {
+    double max_error, rms, psnr;
+    size_t compared, nan_mismatches;
+};
+
+static Accuracy compare(const buffer_t *ref, const buffer_t *out) {
+    Accuracy a;
+    a.max_error = 0;
+    a.compared = a.nan_mismatches = 0;
+    double squares = 0;
+    for (int c = 0; c < ref->extent[2]; c++) {
+        for (int y = 0; y < ref->extent[1]; y++) {
+            for (int x = 0; x < ref->extent[0]; x++) {
+                float r = ((const float *)ref->host)[x * ref->stride[0] + y * ref->stride[1] + c * ref->stride[2]];
+                float v = ((const float *)out->host)[x * out->stride[0] + y * out->stride[1] + c * out->stride[2]];
+                if (!isfinite(r) || !isfinite(v)) {
+                    if (isnan(r) != isnan(v)) a.nan_mismatches++;
+                    continue;
+                }
+                double e = fabs((double)v - r);
+                if (e > a.max_error) a.max_error = e;
+                squares += e * e;
+                a.compared++;
+            }
+        }
+    }
+    a.rms = a.compared ? sqrt(squares / a.compared) : 0;
+    a.psnr = a.rms > 0 ? -20 * log10(a.rms) : INFINITY;
+    return a;
+}
+
+int main(int argc, char **argv) {
+    int levels = 3, trials = 10;
+    std::string which = "flat", image;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:N:t:s:i:")) != -1) {
+        switch (opt) {
+        case 'l': levels = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        case 'i': image = optarg; break;
+        default:
+            fprintf(stderr, "usage: interpolate_precision [-l levels] [-N size] [-t trials] [-s schedule]\n"
+                            "                             [-i image]\n");
+            return 2;
+        }
+    }
+
+    const char *names[] = {"float32", "unorm16"};
+    std::vector<Buffer> outputs;
+    std::vector<autotune::Result> results;
+    std::vector<size_t> alloc_bytes;
+    std::vector<autotune::MappedImage> images(2);
+    for (int v = 0; v < 2; v++) {
+        pipelines::Interpolate p = pipelines::make_interpolate(levels, false, false, v == 1);
+        if (size.empty()) size = p.size;
+        if (!schedule_interpolate(p, which)) {
+            fprintf(stderr, "can't read a schedule from %s\n", which.c_str());
+            return 1;
+        }
+        // The same seed, so the same image for both
+        outputs.push_back(autotune::prepare(p.output, size));
+        if (!image.empty() && !autotune::bind_file(p.output, image, images[v])) return 1;
+        results.push_back(autotune::measure(p.output, outputs.back(), trials));
+        alloc_bytes.push_back(autotune::alloc_stats().total);
+        const autotune::Result &r = results.back();
+        printf("{\"storage\": \"%s\", \"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu, \"alloc_bytes\": %zu}\n",
+               names[v], r.time, r.peak_mem, r.allocs, alloc_bytes.back());
+        fflush(stdout);
+    }
+
+    Accuracy a = compare(outputs[0].raw_buffer(), outputs[1].raw_buffer());
+    printf("{\"levels\": %d, \"speedup\": %.4f, \"peak_mem_saved\": %.4f, \"alloc_bytes_saved\": %.4f, "
+           "\"max_error\": %g, \"rms\": %g, \"psnr\": %.2f, \"compared\": %zu, \"nan_mismatches\": %zu}\n",
+           levels, results[0].time / results[1].time,
+           results[0].peak_mem ? 1 - (double)results[1].peak_mem / results[0].peak_mem : 0,
+           alloc_bytes[0] ? 1 - (double)alloc_bytes[1] / alloc_bytes[0] : 0,
+           a.max_error, a.rms, isinf(a.psnr) ? -1 : a.psnr, a.compared, a.nan_mismatches);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// How the interpolate pyramid scales with depth.
+//
+//   bench/interpolate_scaling [-m min_levels] [-L max_levels] [-N size]
+//                             [-t trials] [-s root|flat|template.txt]
+//
+// Builds the pipeline for each depth from min_levels to max_levels (the
+// depth is a runtime parameter of pipelines::make_interpolate), schedules
+// it, and prints one JSON line per depth with the time, peak memory and
+// the cost of the level just added.
+//
+// Each level works on a quarter of the pixels of the one above, so the
+// total cost should approach 4/3 of the single-level cost:
+// ideal(L) = t(1) * (1 + 1/4 + ... + 1/4^(L-1)). "excess" is
+// time / ideal; values well above 1 at depth mean the coarse levels cost
+// more than their size warrants (fixed per-Func overhead, split factors
+// larger than the level, parallel loops with too few iterations).
+//
+// Schedules: "root" computes every Func at root, "flat" is the test
+// cases' flat parallel + vectorized schedule extended to every level, and
+// a file is a level-parametric template from search/tune -L -w, expanded
+// for each depth (bench/interpolate_schedules.h).
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/interpolate_schedules.h"
+#include "harness/harness.h"
+#include "pipelines/interpolate.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    int min_levels = 1, max_levels = 10, trials = 5;
+    std::vector<int> size;
+    std::string which = "flat";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:L:N:t:s:")) != -1) {
+        switch (opt) {
+        case 'm': min_levels = atoi(optarg); break;
+        case 'L': max_levels = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: interpolate_scaling [-m min_levels] [-L max_levels] [-N size] [-t trials]\n"
+                            "                           [-s root|flat|template.txt]\n");
+            return 2;
+        }
+    }
+    if (min_levels < 1) min_levels = 1;
+
+    double unit = 0, previous = 0;
+    for (int levels = min_levels; levels <= max_levels; levels++) {
+        pipelines::Interpolate p = pipelines::make_interpolate(levels);
+        if (size.empty()) size = p.size;
+        if (!schedule_interpolate(p, which)) {
+            fprintf(stderr, "can't read a schedule from %s\n", which.c_str());
+            return 1;
+        }
+        Buffer output = autotune::prepare(p.output, size);
+        autotune::Result r = autotune::measure(p.output, output, trials);
+
+        // Costs relative to the shallowest pyramid measured, scaled to
+        // what a one-level pyramid would cost
+        double ideal_sum = (1 - pow(0.25, levels)) / 0.75;
+        if (levels == min_levels) unit = r.time / ideal_sum;
+        double ideal = unit * ideal_sum;
+        double level_cost = levels == min_levels ? r.time : r.time - previous;
+        double level_ideal = unit * pow(0.25, levels - 1);
+        previous = r.time;
+
+        printf("{\"levels\": %d, \"time\": %.10f, \"ideal\": %.10f, \"excess\": %.4f, "
+               "\"level_cost\": %.10f, \"level_ideal\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu}\n",
+               levels, r.time, ideal, r.time / ideal, level_cost, level_ideal, r.peak_mem, r.allocs);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef BENCH_INTERPOLATE_SCHEDULES_H
+#define BENCH_INTERPOLATE_SCHEDULES_H
+
+// Schedules the interpolate benchmarks choose from by name.
+
+#include <Halide.h>
+
+#include <random>
+#include <string>
+
+#include "pipelines/interpolate.h"
+#include "search/apply.h"
+#include "search/evolve.h"
+#include "search/template.h"
+
+// Schedule 2 of the interpolate test cases, for every level: channel
+// innermost and vectorized across the 4 channels. transposed stores the
+// levels column by column (reorder_storage(c, y, x)), as many generated
+// schedules do, so that neighbouring pixels of the row-order loops are a
+// whole column apart in memory.
+inline void schedule_flat(pipelines::Interpolate &p, bool transposed = false) {
+    using Halide::Var;
+    Var x = p.x, y = p.y, c = p.c, xi("xi"), yi("yi");
+    Var inner = transposed ? y : x, outer = transposed ? x : y;
+    p.clamped.compute_root().parallel(y).reorder(c, x, y).reorder_storage(c, inner, outer).vectorize(c, 4);
+    for (unsigned int l = 1; l < p.levels; ++l) {
+        p.downsampled[l].compute_root().parallel(y).reorder(c, x, y).reorder_storage(c, inner, outer).vectorize(c, 4);
+    }
+    for (unsigned int l = 0; l < p.levels; ++l) {
+        p.interpolated[l].compute_root().parallel(y).reorder(c, x, y).reorder_storage(c, inner, outer).vectorize(c, 4);
+        p.interpolated[l].unroll(x, 2).unroll(y, 2);
+    }
+    p.final.reorder(c, x, y).bound(c, 0, 3).parallel(y);
+    p.final.tile(x, y, xi, yi, 2, 2).unroll(xi).unroll(yi);
+}
+
+// Every Func at root except the ones the test cases' simplest schedules
+// compute inside their consumer's innermost loop: each level's downx per
+// x of downsampled and upsampledx per x of upsampled, which allocates
+// and frees them once per pixel
+inline void schedule_inner(pipelines::Interpolate &p) {
+    std::mt19937 rng(0);
+    search::apply(search::Operators(search::describe(p), rng).root_schedule(), p);
+    for (unsigned int l = 1; l < p.levels; ++l) p.downx[l].compute_at(p.downsampled[l], p.x);
+    for (unsigned int l = 0; l < p.levels - 1; ++l) p.upsampledx[l].compute_at(p.upsampled[l], p.x);
+}
+
+// "root" computes every Func at root, "flat" is schedule_flat,
+// "transposed" is schedule_flat with transposed storage, "inner" is
+// schedule_inner, and anything else is a file for
+// search::load_schedule: a schedule for this depth, or a level-parametric
+// template (search/tune -L -w), which is expanded for it. Returns false
+// if the file has no schedule.
+inline bool schedule_interpolate(pipelines::Interpolate &p, const std::string &which) {
+    search::PipelineInfo info = search::describe(p);
+    if (which == "flat") {
+        schedule_flat(p);
+    } else if (which == "transposed") {
+        schedule_flat(p, true);
+    } else if (which == "inner") {
+        schedule_inner(p);
+    } else if (which == "root") {
+        std::mt19937 rng(0);
+        search::apply(search::Operators(info, rng).root_schedule(), p);
+    } else {
+        search::Schedule s;
+        if (!search::load_schedule(which, s)) return false;
+        search::PipelineInfo tinfo = search::template_info(info);
+        bool is_template = true;
+        for (size_t i = 0; i < s.funcs.size(); i++) is_template = is_template && tinfo.find(s.funcs[i].name);
+        search::apply(is_template ? search::expand(s, info) : s, p);
+    }
+    return true;
+}
+
+#endif
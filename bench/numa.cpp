@@ -0,0 +1,93 @@
+// Where a parallel schedule's intermediates are placed on a NUMA
+// machine: the policies of harness/numa.h against each other.
+//
+//   bench/numa [-p interpolate|bilateral_grid|blur] [-l levels]
+//              [-j threads] [-S stripes] [-r] [-N size] [-t trials]
+//              [-s schedule]
+//
+// Builds the pipeline once per policy under the same schedule, with
+// compile(func, Numa), and prints one JSON line each: "first_touch" (the
+// kernel's default), "interleave" and "partitioned" (-S stripes per
+// node, default 1, see numa.h). The parallel loops run on the work
+// pool's workers, pinned node by node, which partitioned placement
+// relies on; -r runs them on the runtime's pool instead. "node_loads" and
+// "remote_loads" are per realization, and -1 where perf can't count them.
+// On a machine with one node every policy is first touch, and the lines
+// should agree.
+//
+// -s names a schedule, or a schedule file, as in bench/scheduled.h.
+// The flat interpolate schedule stores its intermediates row by row and
+// computes them in parallel over rows, as partitioned placement expects.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/numa.h"
+#include "harness/pool.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, threads = 0, stripes = 1, trials = 10;
+    bool runtime_pool = false;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:j:S:rN:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'S': stripes = atoi(optarg); break;
+        case 'r': runtime_pool = true; break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: numa [-p interpolate|bilateral_grid|blur] [-l levels] [-j threads] [-S stripes]\n"
+                            "            [-r] [-N size] [-t trials] [-s schedule]\n");
+            return 2;
+        }
+    }
+    if (threads > 0) setenv("HL_NUMTHREADS", std::to_string(threads).c_str(), 1);
+    // Before any worker starts, so they all inherit the counters
+    bool counted = autotune::open_node_counters();
+    if (!runtime_pool) autotune::start_work_pool(threads);
+    autotune::numa_stripes() = stripes;
+
+    const char *names[] = {"first_touch", "interleave", "partitioned"};
+    const autotune::NumaPolicy policies[] = {autotune::FirstTouch, autotune::Interleave, autotune::Partitioned};
+    double base = 0;
+    for (int v = 0; v < 3; v++) {
+        pipelines::Pipeline p;
+        if (!build_scheduled(name, levels, false, which, p)) {
+            fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+            return 1;
+        }
+        if (size.empty()) size = p.size;
+        if (!runtime_pool) p.output.set_custom_do_par_for(autotune::work_pool_do_par_for);
+        autotune::numa_policy() = policies[v];
+        autotune::compile(p.output, autotune::Numa);
+        Buffer output = autotune::bind(p.output, size);
+        autotune::NodeLoads before = autotune::read_node_counters();
+        autotune::Result r = autotune::measure(p.output, output, trials);
+        autotune::NodeLoads after = autotune::read_node_counters();
+        if (v == 0) base = r.time;
+        double loads = counted && before.loads >= 0 ? (double)(after.loads - before.loads) / trials : -1;
+        double remote = counted && before.remote >= 0 ? (double)(after.remote - before.remote) / trials : -1;
+        printf("{\"policy\": \"%s\", \"time\": %.10f, \"speedup\": %.4f, \"nodes\": %zu, \"node_loads\": %.0f, "
+               "\"remote_loads\": %.0f, \"remote_fraction\": %.4f, \"peak_mem\": %zu}\n",
+               names[v], r.time, base / r.time, autotune::numa_nodes().size(), loads, remote,
+               loads > 0 && remote >= 0 ? remote / loads : -1, r.peak_mem);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef BENCH_SCHEDULED_H
+#define BENCH_SCHEDULED_H
+
+// A pipeline built and scheduled by name, for the benchmarks that take
+// any of interpolate, bilateral_grid and blur. Their -s option is one of
+// these names (the first is the default) or a schedule file:
+//   interpolate     flat, transposed, inner, root (bench/interpolate_schedules.h)
+//   bilateral_grid  classic, root (bench/bilateral_schedules.h)
+//   blur            tiled, root (bench/blur_schedules.h)
+// A file is anything search::load_schedule reads: a test case, or a
+// schedule or template written by search/tune.
+
+#include <Halide.h>
+
+#include <string>
+
+#include "bench/bilateral_schedules.h"
+#include "bench/blur_schedules.h"
+#include "bench/interpolate_schedules.h"
+#include "pipelines/pipelines.h"
+
+// A fresh build of the named pipeline, the padded variant if asked,
+// under the named schedule ("" for the default). Returns false for other
+// pipelines and for files without a schedule.
+inline bool build_scheduled(const std::string &name, int levels, bool padded, const std::string &which,
+                            pipelines::Pipeline &out) {
+    if (name == "interpolate") {
+        pipelines::Interpolate p = pipelines::make_interpolate(levels, false, padded);
+        if (!schedule_interpolate(p, which.empty() ? "flat" : which)) return false;
+        out = p;
+    } else if (name == "bilateral_grid") {
+        pipelines::BilateralGrid p = pipelines::make_bilateral_grid(4, 0.1f, false, padded);
+        if (!schedule_bilateral(p, which.empty() ? "classic" : which)) return false;
+        out = p;
+    } else if (name == "blur") {
+        pipelines::Blur p = pipelines::make_blur(false, padded);
+        if (!schedule_blur(p, which.empty() ? "tiled" : which)) return false;
+        out = p;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#endif
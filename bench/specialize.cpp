@@ -0,0 +1,119 @@
+// What specializing for sizes that are multiples of the split factors
+// buys.
+//
+//   bench/specialize [-p pipeline] [-l levels] [-m multiple] [-N size]
+//                    [-t trials] [-s schedule]
+//
+// Builds the pipeline twice under the same schedule, once as it is and
+// once with the output bound to multiples of -m (default 64) through
+// harness/specialize.h, and prints one JSON line for each:
+//
+//   generic      the ordinary build at the given size
+//   specialized  the bound build at the same size (which must be a
+//                multiple), with "max_diff" from generic's output
+//   dispatched   the size minus one in x and y, which pick() has to send
+//                to the generic build
+//
+// Pipelines: interpolate, interpolate_rgba (schedule flat, root or a
+// file; see bench/interpolate_schedules.h), blur and blur_fixed (tiled,
+// root or a file; see bench/blur_schedules.h).
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/blur_schedules.h"
+#include "bench/interpolate_schedules.h"
+#include "harness/harness.h"
+#include "harness/specialize.h"
+#include "pipelines/pipelines.h"
+
+using namespace Halide;
+
+// A fresh build of the named pipeline under the named schedule ("" for
+// the pipeline's default)
+static bool make_scheduled(const std::string &name, int levels, std::string which, pipelines::Pipeline &out) {
+    if (name == "interpolate" || name == "interpolate_rgba") {
+        pipelines::Interpolate p = pipelines::make_interpolate(levels, name == "interpolate_rgba");
+        if (!schedule_interpolate(p, which.empty() ? "flat" : which)) return false;
+        out = p;
+    } else if (name == "blur" || name == "blur_fixed") {
+        pipelines::Blur p = pipelines::make_blur(name == "blur_fixed");
+        if (!schedule_blur(p, which.empty() ? "tiled" : which)) return false;
+        out = p;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void print_line(const char *path, const std::vector<int> &size, const autotune::Result &r) {
+    printf("{\"path\": \"%s\", \"size\": \"%dx%d\", \"time\": %.10f, \"peak_mem\": %zu",
+           path, size[0], size[1], r.time, r.peak_mem);
+}
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, multiple = 64, trials = 10;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:m:N:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'm': multiple = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: specialize [-p pipeline] [-l levels] [-m multiple] [-N size] [-t trials]\n"
+                            "                  [-s schedule]\n");
+            return 2;
+        }
+    }
+
+    pipelines::Pipeline generic, special;
+    if (!make_scheduled(name, levels, which, generic) || !make_scheduled(name, levels, which, special)) {
+        fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+        return 1;
+    }
+    if (size.empty()) size = generic.size;
+    autotune::Specialized s = autotune::specialize(generic.output, special.output, multiple);
+    if (!s.matches(size)) {
+        fprintf(stderr, "%dx%d is not a multiple of %d\n", size[0], size[1], multiple);
+        return 1;
+    }
+    autotune::compile(s.generic);
+    autotune::compile(s.special);
+
+    Buffer generic_out = autotune::bind(s.generic, size);
+    autotune::Result g = autotune::measure(s.generic, generic_out, trials);
+    print_line("generic", size, g);
+    printf("}\n");
+    fflush(stdout);
+
+    Func &picked = s.pick(size);
+    Buffer special_out = autotune::bind(picked, size);
+    autotune::Result r = autotune::measure(picked, special_out, trials);
+    print_line("specialized", size, r);
+    // -1 for outputs that don't match at all (see max_difference)
+    double diff = autotune::max_difference(generic_out, special_out);
+    printf(", \"speedup\": %.4f, \"max_diff\": %g}\n", g.time / r.time, isinf(diff) ? -1 : diff);
+    fflush(stdout);
+
+    std::vector<int> odd = size;
+    odd[0]--;
+    odd[1]--;
+    Func &fallback = s.pick(odd);
+    Buffer odd_out = autotune::bind(fallback, odd);
+    autotune::Result d = autotune::measure(fallback, odd_out, trials);
+    print_line("dispatched", odd, d);
+    printf(", \"to\": \"%s\"}\n", &fallback == &s.generic ? "generic" : "specialized");
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Out-of-core interpolate: a raw float image file in, a raw float image
+// file out, in strips (harness/stream.h).
+//
+//   bench/streaming -i input.raw -o output.raw -N WxH [-g] [-c]
+//                   [-p interpolate|interpolate_rgba] [-l levels]
+//                   [-r rows] [-s schedule]
+//
+// The input is RGBA float, planar for interpolate and interleaved for
+// interpolate_rgba; the output is planar RGB float. -g writes the input
+// file first (the harness's fill pattern, a strip at a time, so it works
+// for images that don't fit in memory). -r is the strip height (default
+// 256). -s schedules the pipeline: flat, root or a file (see
+// bench/interpolate_schedules.h).
+//
+// Prints one JSON line: the time for the whole image, the number of
+// strips, "halo" (input rows read over all strips per image row, 1 with
+// no overlap), the pipeline's largest allocation high-water mark in a
+// strip and the process's peak resident set, against "image_bytes", what
+// holding the input and output in memory would take, and "copied", the
+// bytes of windows too far into a large image for Halide to address in
+// place, which went through dense copies instead. -c also realizes the
+// whole image in memory and reports "max_diff" from the streamed output,
+// for sizes Halide can address whole (under 2^31 elements or so).
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/interpolate_schedules.h"
+#include "harness/harness.h"
+#include "harness/stream.h"
+#include "pipelines/interpolate.h"
+
+using namespace Halide;
+
+// Fill a mapped raw image rows at a time, dropping each block once written
+static void generate(const buffer_t &layout, const autotune::MappedFile &f, int rows, int y_dim) {
+    int h = layout.extent[y_dim];
+    for (int y = 0; y < h; y += rows) {
+        int min[4] = {0, 0, 0, 0}, extent[4];
+        for (int i = 0; i < 4; i++) extent[i] = layout.extent[i];
+        min[y_dim] = y;
+        extent[y_dim] = h - y < rows ? h - y : rows;
+        buffer_t b = autotune::window_of(layout, f.data, min, extent);
+        autotune::fill_buffer(Buffer(Float(32), &b), 0);
+        autotune::advise_window(layout, f.data, min, extent, MADV_DONTNEED, true, y_dim);
+    }
+}
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which = "flat", in_path, out_path;
+    int levels = 3, rows = 256;
+    bool gen = false, check = false;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:N:gcp:l:r:s:")) != -1) {
+        switch (opt) {
+        case 'i': in_path = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 'g': gen = true; break;
+        case 'c': check = true; break;
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'r': rows = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            in_path.clear();
+        }
+    }
+    if (in_path.empty() || out_path.empty() || size.size() < 2 || rows < 1 ||
+        (name != "interpolate" && name != "interpolate_rgba")) {
+        fprintf(stderr, "usage: streaming -i input.raw -o output.raw -N WxH [-g] [-c]\n"
+                        "                 [-p interpolate|interpolate_rgba] [-l levels] [-r rows] [-s schedule]\n");
+        return 2;
+    }
+
+    bool interleaved = name == "interpolate_rgba";
+    int in_y = interleaved ? 2 : 1;
+    pipelines::Interpolate p = pipelines::make_interpolate(levels, interleaved);
+    if (!schedule_interpolate(p, which)) {
+        fprintf(stderr, "can't read a schedule from %s\n", which.c_str());
+        return 1;
+    }
+    autotune::compile(p.output);
+
+    int w = size[0], h = size[1];
+    int planar[] = {w, h, 4, 0}, rgba[] = {4, w, h, 0}, rgb[] = {w, h, 3, 0}, order[] = {0, 1, 2};
+    std::vector<int> in_extents = interleaved ? std::vector<int>(rgba, rgba + 4) : std::vector<int>(planar, planar + 4);
+    buffer_t in_layout, out_layout;
+    if (!autotune::raw_layout(Float(32), in_extents, std::vector<int>(order, order + 3), in_layout) ||
+        !autotune::raw_layout(Float(32), std::vector<int>(rgb, rgb + 4), std::vector<int>(order, order + 3), out_layout)) {
+        fprintf(stderr, "%dx%d is too large: a row or plane stride doesn't fit in an int\n", w, h);
+        return 1;
+    }
+    if (check && (!autotune::addressable(in_layout) || !autotune::addressable(out_layout))) {
+        fprintf(stderr, "-c: %dx%d is too large to realize whole with Halide's 32-bit indexing\n", w, h);
+        return 1;
+    }
+
+    autotune::MappedFile in, out;
+    if (!autotune::map_file(in_path, autotune::layout_bytes(in_layout), gen, in)) {
+        fprintf(stderr, "can't map %s as a %dx%d RGBA float image\n", in_path.c_str(), w, h);
+        return 1;
+    }
+    if (!autotune::map_file(out_path, autotune::layout_bytes(out_layout), true, out)) {
+        fprintf(stderr, "can't create %s\n", out_path.c_str());
+        return 1;
+    }
+    if (gen) generate(in_layout, in, rows, in_y);
+
+    autotune::StreamStats s = autotune::stream_strips(p.output, in, in_layout, out, out_layout, rows, in_y);
+    if (!s.error.empty()) {
+        fprintf(stderr, "%dx%d %s: %s\n", w, h, name.c_str(), s.error.c_str());
+        return 1;
+    }
+    printf("{\"pipeline\": \"%s\", \"size\": \"%dx%d\", \"rows\": %d, \"time\": %.10f, \"strips\": %d, "
+           "\"halo\": %.4f, \"peak_mem\": %zu, \"max_rss\": %zu, \"image_bytes\": %zu, "
+           "\"copied\": %zu",
+           name.c_str(), w, h, rows, s.time, s.strips, (double)s.input_rows / h, s.peak_mem, s.max_rss,
+           autotune::layout_bytes(in_layout) + autotune::layout_bytes(out_layout), s.copied);
+
+    if (check) {
+        // The whole image at once, from the same mapped input
+        buffer_t image = in_layout;
+        image.host = in.data;
+        autotune::find_input_params(p.output)[0].set_buffer(Buffer(Float(32), &image));
+        Buffer whole(Float(32), w, h, 3);
+        p.output.realize(whole);
+        buffer_t streamed = out_layout;
+        streamed.host = out.data;
+        // -1 for outputs that don't match at all (see max_difference)
+        double diff = autotune::max_difference(whole, Buffer(Float(32), &streamed));
+        printf(", \"max_diff\": %g", isinf(diff) ? -1 : diff);
+    }
+    printf("}\n");
+
+    autotune::unmap_file(in);
+    autotune::unmap_file(out);
+    return 0;
+}
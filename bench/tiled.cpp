@@ -0,0 +1,109 @@
+// Tiled realization under a memory budget (harness/tiled.h).
+//
+//   bench/tiled [-p interpolate|bilateral_grid|blur] [-l levels]
+//               [-b budget_mb] [-j workers] [-N size] [-t trials]
+//               [-s schedule]
+//
+// Realizes the whole output at once, then again in tiles sized so that
+// the pipeline's allocations stay within -b megabytes (default 64) with
+// -j workers (default 1: one tile after another), each worker realizing
+// its own build of the pipeline. Prints one JSON line for each, then the
+// trade: "halo" is the input points the tiles read per point the whole
+// realization reads (the redundant halo work is roughly halo - 1),
+// "time_overhead" is tiled time / whole time - 1, "memory_saved" is
+// 1 - tiled peak / whole peak, and "max_diff" compares the outputs.
+//
+// -s names a schedule, or a schedule file, as in bench/scheduled.h.
+// Tiling bounds what is computed at root; Funcs computed inside the
+// output's loops are tile-sized either way.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/tiled.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, workers = 1, trials = 5;
+    double budget_mb = 64;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:b:j:N:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'b': budget_mb = atof(optarg); break;
+        case 'j': workers = atoi(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: tiled [-p interpolate|bilateral_grid|blur] [-l levels] [-b budget_mb] [-j workers]\n"
+                            "             [-N size] [-t trials] [-s schedule]\n");
+            return 2;
+        }
+    }
+    if (workers < 1) workers = 1;
+
+    std::vector<pipelines::Pipeline> builds(workers);
+    std::vector<Func> funcs;
+    for (int i = 0; i < workers; i++) {
+        if (!build_scheduled(name, levels, false, which, builds[i])) {
+            fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+            return 1;
+        }
+        funcs.push_back(builds[i].output);
+    }
+    if (size.empty()) size = builds[0].size;
+
+    // Every worker reads the inputs bound for the first build
+    Buffer whole_out = autotune::prepare(funcs[0], size);
+    std::vector<Internal::Parameter> inputs = autotune::find_input_params(funcs[0]);
+    for (int i = 1; i < workers; i++) {
+        autotune::compile(funcs[i]);
+        std::vector<Internal::Parameter> params = autotune::find_input_params(funcs[i]);
+        for (size_t k = 0; k < params.size() && k < inputs.size(); k++) params[k].set_buffer(inputs[k].get_buffer());
+    }
+
+    autotune::Result whole = autotune::measure(funcs[0], whole_out, trials);
+    printf("{\"realize\": \"whole\", \"time\": %.10f, \"peak_mem\": %zu}\n", whole.time, whole.peak_mem);
+    fflush(stdout);
+
+    size_t budget = (size_t)(budget_mb * 1024 * 1024);
+    const buffer_t *o = whole_out.raw_buffer();
+    Buffer tiled_out(whole_out.type(), o->extent[0], o->extent[1], o->extent[2], o->extent[3]);
+    int w, h;
+    if (!autotune::fit_tile(funcs[0], tiled_out, budget / workers, w, h)) {
+        fprintf(stderr, "even 8x8 tiles need more than %g MB per worker\n", budget_mb / workers);
+        return 1;
+    }
+
+    autotune::TiledStats best;
+    best.time = 0;
+    for (int t = 0; t < trials; t++) {
+        autotune::TiledStats s = autotune::realize_tiled(funcs, tiled_out, w, h);
+        if (t == 0 || s.time < best.time) best = s;
+    }
+    double halo = autotune::halo_overhead(funcs[0], tiled_out, w, h);
+    printf("{\"realize\": \"tiled\", \"tile\": \"%dx%d\", \"tiles\": %d, \"workers\": %d, \"time\": %.10f, "
+           "\"peak_mem\": %zu, \"budget\": %zu}\n",
+           w, h, best.tiles, workers, best.time, best.peak_mem, budget);
+
+    // -1 for outputs that don't match at all (see max_difference)
+    double diff = autotune::max_difference(whole_out, tiled_out);
+    printf("{\"pipeline\": \"%s\", \"halo\": %.4f, \"time_overhead\": %.4f, \"memory_saved\": %.4f, \"max_diff\": %g}\n",
+           name.c_str(), halo, best.time / whole.time - 1,
+           whole.peak_mem ? 1 - (double)best.peak_mem / whole.peak_mem : 0, isinf(diff) ? -1 : diff);
+    return 0;
+}
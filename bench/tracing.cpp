@@ -0,0 +1,78 @@
+// What recording a timeline with harness/trace.h costs.
+//
+//   bench/tracing [-p interpolate|bilateral_grid|blur] [-l levels]
+//                 [-S store_every] [-r ring] [-N size] [-t trials]
+//                 [-s schedule] [-o timeline.json]
+//
+// Builds the pipeline three times under the same schedule: untraced,
+// tracing realizations and produce/consume, and tracing those plus one
+// in store_every stores (default 1000). Prints one JSON line each with
+// the time, the slowdown against untraced, and the events recorded per
+// realization and lost to full rings (of -r events per thread, default
+// 65536). -o writes the last build's timeline.
+//
+// -s names a schedule, or a schedule file, as in bench/scheduled.h.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/trace.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which, timeline;
+    int levels = 3, store_every = 1000, trials = 5;
+    size_t ring = 1 << 16;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:S:r:N:t:s:o:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'S': store_every = atoi(optarg); break;
+        case 'r': ring = atol(optarg); break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        case 'o': timeline = optarg; break;
+        default:
+            fprintf(stderr, "usage: tracing [-p interpolate|bilateral_grid|blur] [-l levels] [-S store_every] [-r ring]\n"
+                            "               [-N size] [-t trials] [-s schedule] [-o timeline.json]\n");
+            return 2;
+        }
+    }
+
+    // Untraced first: enable_tracing leaves HL_TRACE set for later builds
+    const char *names[] = {"none", "realizations", "stores"};
+    double base = 0;
+    for (int v = 0; v < 3; v++) {
+        pipelines::Pipeline p;
+        if (!build_scheduled(name, levels, false, which, p)) {
+            fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+            return 1;
+        }
+        if (size.empty()) size = p.size;
+        if (v > 0) autotune::enable_tracing(p.output, v == 2 ? store_every : 0, ring);
+        Buffer output = autotune::prepare(p.output, size);
+        autotune::reset_trace();
+        autotune::Result r = autotune::measure(p.output, output, trials);
+        if (v == 0) base = r.time;
+        size_t recorded, dropped;
+        autotune::trace_counts(recorded, dropped);
+        int runs = (int)r.samples.size();
+        printf("{\"trace\": \"%s\", \"time\": %.10f, \"slowdown\": %.4f, \"events\": %.0f, \"dropped\": %zu}\n",
+               names[v], r.time, r.time / base, runs ? (double)recorded / runs : 0, dropped);
+        fflush(stdout);
+        if (v == 2 && !timeline.empty() && autotune::write_trace(timeline.c_str()) < 0) return 1;
+    }
+    return 0;
+}
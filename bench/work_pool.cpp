@@ -0,0 +1,90 @@
+// Halide's own thread pool against the work-stealing one in
+// harness/pool.h.
+//
+//   bench/work_pool [-p interpolate|bilateral_grid|blur] [-l levels]
+//                   [-j threads] [-c chunks] [-u] [-N size] [-t trials]
+//                   [-s schedule]
+//
+// Builds the pipeline twice under the same schedule, one realized on
+// the runtime's pool and one with set_custom_do_par_for on the
+// work-stealing pool, both with -j threads (default: one per core).
+// Prints one JSON line for each, then one per worker of the
+// work-stealing pool over all its trials: busy and idle seconds, chunks
+// run and shares stolen. The last "worker" is the thread that calls
+// realize, which works on every loop it starts. -c is the chunks each
+// worker's share of a loop is cut into (default 4), -u leaves the
+// workers unpinned.
+//
+// -s names a schedule, or a schedule file, as in bench/scheduled.h.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "bench/scheduled.h"
+#include "harness/harness.h"
+#include "harness/pool.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    std::string name = "interpolate", which;
+    int levels = 3, threads = 0, chunks = 4, trials = 10;
+    bool pin = true;
+    std::vector<int> size;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:j:c:uN:t:s:")) != -1) {
+        switch (opt) {
+        case 'p': name = optarg; break;
+        case 'l': levels = atoi(optarg); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'c': chunks = atoi(optarg); break;
+        case 'u': pin = false; break;
+        case 'N': size = autotune::parse_size(optarg); break;
+        case 't': trials = atoi(optarg); break;
+        case 's': which = optarg; break;
+        default:
+            fprintf(stderr, "usage: work_pool [-p interpolate|bilateral_grid|blur] [-l levels] [-j threads] [-c chunks]\n"
+                            "                 [-u] [-N size] [-t trials] [-s schedule]\n");
+            return 2;
+        }
+    }
+    // The runtime's pool reads this when it starts, at the first realize
+    if (threads > 0) setenv("HL_NUMTHREADS", std::to_string(threads).c_str(), 1);
+
+    pipelines::Pipeline builds[2];
+    for (int v = 0; v < 2; v++) {
+        if (!build_scheduled(name, levels, false, which, builds[v])) {
+            fprintf(stderr, "can't build %s with schedule %s\n", name.c_str(), which.c_str());
+            return 1;
+        }
+    }
+    if (size.empty()) size = builds[0].size;
+
+    Buffer runtime_out = autotune::prepare(builds[0].output, size);
+    autotune::Result r = autotune::measure(builds[0].output, runtime_out, trials);
+    printf("{\"pool\": \"runtime\", \"time\": %.10f}\n", r.time);
+    fflush(stdout);
+
+    autotune::start_work_pool(threads, pin, chunks);
+    builds[1].output.set_custom_do_par_for(autotune::work_pool_do_par_for);
+    Buffer pool_out = autotune::prepare(builds[1].output, size);
+    autotune::reset_work_pool_stats();
+    autotune::Result w = autotune::measure(builds[1].output, pool_out, trials);
+    std::vector<autotune::WorkerStats> stats = autotune::work_pool_stats();
+    // -1 for outputs that don't match at all (see max_difference)
+    double diff = autotune::max_difference(runtime_out, pool_out);
+    printf("{\"pool\": \"work_stealing\", \"time\": %.10f, \"workers\": %d, \"speedup\": %.4f, \"max_diff\": %g}\n",
+           w.time, (int)stats.size() - 1, r.time / w.time, isinf(diff) ? -1 : diff);
+    for (size_t i = 0; i < stats.size(); i++) {
+        printf("{\"worker\": %d, \"busy\": %.6f, \"idle\": %.6f, \"chunks\": %zu, \"steals\": %zu}\n",
+               i + 1 < stats.size() ? (int)i : -1, stats[i].busy, stats[i].idle, stats[i].chunks, stats[i].steals);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef AUTOTUNE_BATCH_H
+#define AUTOTUNE_BATCH_H
+
+// Batch mode: realize a stream of frames of one size, the way a video
+// pipeline runs, instead of one image per process. Output buffers are
+// allocated once and reused, and with a pipeline compiled with
+// compile(func, Retaining) so are its compute_root intermediates, so
+// from the second frame on a frame costs only its computation. Comparing
+// against the counting allocator shows what allocating and faulting in
+// the intermediates costs per frame, which one-shot timing can't
+// separate.
+//
+// Frames run back to back, or pipelined: with several builds of the
+// pipeline (one per frame in flight, each with its own output) up to
+// that many frames run at once, each started as soon as a build is free.
+// Every frame reads the same input.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "memory.h"
+#include "stats.h"
+
+namespace autotune {
+
+struct BatchResult {
+    double first;                   // slowest of the builds' first frames, not counted below
+    std::vector<double> latencies;  // every timed frame, by frame number
+    double wall;                    // wall time for the timed frames
+    double allocs;                  // allocations per frame not served from retained blocks
+    double faults;                  // page faults per frame
+    size_t peak_mem;                // high-water mark of the pipelines' allocations
+};
+
+// Realize frames frames, spread over funcs (one build per frame in
+// flight, compiled and bound) into the matching outputs. Each build
+// realizes one untimed frame first. A nonzero limit arms an alarm for
+// those first frames, as in measure().
+inline BatchResult run_batch(std::vector<Halide::Func> &funcs, std::vector<Halide::Buffer> &outputs, int frames,
+                             unsigned int limit = 0) {
+    BatchResult r;
+    r.first = 0;
+    alarm(limit);
+    for (size_t i = 0; i < funcs.size(); i++) {
+        double t = realize_once(funcs[i], outputs[i]);
+        if (t > r.first) r.first = t;
+    }
+    alarm(0);
+
+    r.latencies.resize(frames);
+    std::atomic<int> next(0);
+    auto work = [&](size_t worker) {
+        for (int f = next++; f < frames; f = next++) {
+            r.latencies[f] = realize_once(funcs[worker], outputs[worker]);
+        }
+    };
+    reset_alloc_stats();
+    size_t faults = page_faults();
+    double t1 = now();
+    if (funcs.size() == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < funcs.size(); i++) threads.push_back(std::thread(work, i));
+        for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    }
+    r.wall = now() - t1;
+    AllocStats &s = alloc_stats();
+    r.allocs = frames ? (double)(s.count - s.reused) / frames : 0;
+    r.faults = frames ? (double)(page_faults() - faults) / frames : 0;
+    r.peak_mem = s.peak;
+    return r;
+}
+
+// One line of JSON: "time" is the median frame latency, "throughput" is
+// frames per second in steady state
+inline void print_batch_result(const BatchResult &r) {
+    printf("{\"time\": %.10f, \"frames\": %zu, \"first\": %.10f, \"p90\": %.10f, \"p99\": %.10f, \"max\": %.10f, "
+           "\"stddev\": %.10f, \"throughput\": %.4f, \"allocs_per_frame\": %.2f, \"faults_per_frame\": %.2f, "
+           "\"peak_mem\": %zu}\n",
+           median(r.latencies), r.latencies.size(), r.first, percentile(r.latencies, 0.9),
+           percentile(r.latencies, 0.99), percentile(r.latencies, 1), stddev(r.latencies),
+           r.wall > 0 ? r.latencies.size() / r.wall : 0, r.allocs, r.faults, r.peak_mem);
+    fflush(stdout);
+}
+
+}
+
+#endif
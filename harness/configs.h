@@ -0,0 +1,219 @@
+#ifndef AUTOTUNE_CONFIGS_H
+#define AUTOTUNE_CONFIGS_H
+
+// Time one compiled pipeline under several configurations (output size
+// and thread count) and combine them into one objective, so that a
+// schedule isn't tuned to a single size on a single machine shape.
+//
+// A configuration list is written as terms separated by ';':
+//
+//   size[@threads[,threads...]][*weight]
+//
+// e.g. "512x512x3@4,16;2048x2048x3@4,16;4096x4096x3@4,16*0.5". A term
+// with several thread counts stands for one configuration per count.
+// Threads 0 (or no @) leaves the thread pool at its default size.
+//
+// Halide's thread pool reads HL_NUMTHREADS once, when it first starts,
+// so each thread count runs in its own child forked after compilation:
+// one JIT compilation serves every configuration. The pipeline must not
+// have been realized in this process before measure_configs.
+
+#include <Halide.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "harness.h"
+
+namespace autotune {
+
+struct Config {
+    std::vector<int> size;
+    int threads;    // 0 = Halide's default
+    double weight;
+};
+
+inline std::vector<Config> parse_configs(const char *spec) {
+    std::vector<Config> configs;
+    std::string s(spec);
+    size_t begin = 0;
+    while (begin < s.size()) {
+        size_t end = s.find(';', begin);
+        if (end == std::string::npos) end = s.size();
+        std::string term = s.substr(begin, end - begin);
+        begin = end + 1;
+        if (term.empty()) continue;
+
+        double weight = 1;
+        size_t star = term.find('*');
+        if (star != std::string::npos) {
+            weight = atof(term.c_str() + star + 1);
+            term.resize(star);
+        }
+        std::vector<int> threads(1, 0);
+        size_t at = term.find('@');
+        if (at != std::string::npos) {
+            threads = parse_size(term.c_str() + at + 1);
+            term.resize(at);
+        }
+        for (size_t i = 0; i < threads.size(); i++) {
+            Config c;
+            c.size = parse_size(term.c_str());
+            c.threads = threads[i];
+            c.weight = weight;
+            configs.push_back(c);
+        }
+    }
+    return configs;
+}
+
+inline std::string format_size(const std::vector<int> &size) {
+    std::string s;
+    for (size_t i = 0; i < size.size(); i++) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), i ? "x%d" : "%d", size[i]);
+        s += buf;
+    }
+    return s;
+}
+
+struct ConfigResult {
+    bool ok;        // false if the child for this thread count died
+    Result result;  // samples are left empty
+};
+
+// What a measuring child sends back per configuration
+struct _ConfigReply {
+    int index;
+    double time;
+    size_t peak_mem, allocs, max_rss;
+};
+
+// Measure func (compiled, never realized) under every configuration,
+// trials realizations each. A nonzero limit bounds each thread count's
+// child, in seconds, for all of its sizes together.
+inline std::vector<ConfigResult> measure_configs(Halide::Func &func, const std::vector<Config> &configs,
+                                                 int trials, unsigned int limit = 0) {
+    std::vector<ConfigResult> results(configs.size());
+    for (size_t i = 0; i < results.size(); i++) results[i].ok = false;
+
+    std::vector<bool> done(configs.size(), false);
+    for (size_t first = 0; first < configs.size(); first++) {
+        if (done[first]) continue;
+        int threads = configs[first].threads;
+
+        int fds[2];
+        if (pipe(fds)) break;
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(fds[0]);
+            close(fds[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            if (threads > 0) {
+                char buf[16];
+                snprintf(buf, sizeof(buf), "%d", threads);
+                setenv("HL_NUMTHREADS", buf, 1);
+            }
+            alarm(limit);
+            for (size_t i = first; i < configs.size(); i++) {
+                if (configs[i].threads != threads) continue;
+                Halide::Buffer output = bind(func, configs[i].size);
+                Result r = measure(func, output, trials);
+                _ConfigReply reply = {(int)i, r.time, r.peak_mem, r.allocs, r.max_rss};
+                if (write(fds[1], &reply, sizeof(reply)) != sizeof(reply)) _exit(1);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+
+        // Replies are smaller than PIPE_BUF, so they arrive whole
+        _ConfigReply reply;
+        ssize_t n;
+        while ((n = read(fds[0], &reply, sizeof(reply))) == sizeof(reply) || (n < 0 && errno == EINTR)) {
+            if (n < 0 || reply.index < 0 || reply.index >= (int)results.size()) continue;
+            ConfigResult &c = results[reply.index];
+            c.ok = true;
+            c.result.time = reply.time;
+            c.result.peak_mem = reply.peak_mem;
+            c.result.allocs = reply.allocs;
+            c.result.max_rss = reply.max_rss;
+        }
+        close(fds[0]);
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+
+        for (size_t i = first; i < configs.size(); i++) {
+            if (configs[i].threads == threads) done[i] = true;
+        }
+    }
+    return results;
+}
+
+// Weighted geometric mean of the times. Sizes differ by orders of
+// magnitude in time; the geometric mean weighs a 10% gain at 512x512 the
+// same as one at 4096x4096. Infinite if any configuration failed.
+inline double aggregate_time(const std::vector<Config> &configs, const std::vector<ConfigResult> &results) {
+    double logs = 0, weights = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        if (!results[i].ok) return INFINITY;
+        logs += configs[i].weight * log(results[i].result.time > 0 ? results[i].result.time : 1e-9);
+        weights += configs[i].weight;
+    }
+    return weights > 0 ? exp(logs / weights) : INFINITY;
+}
+
+// The most any configuration held: what a deployment has to provide
+inline size_t aggregate_peak_mem(const std::vector<ConfigResult> &results) {
+    size_t peak = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].ok && results[i].result.peak_mem > peak) peak = results[i].result.peak_mem;
+    }
+    return peak;
+}
+
+// One JSON line per configuration, then the aggregate in print_result's
+// format (time being the weighted geometric mean), or {"ok": 0, ...} if
+// a configuration failed
+inline void print_config_results(const std::vector<Config> &configs, const std::vector<ConfigResult> &results) {
+    bool all_ok = true;
+    size_t allocs = 0, max_rss = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        const Result &r = results[i].result;
+        if (!results[i].ok) {
+            all_ok = false;
+            printf("{\"config\": %zu, \"size\": \"%s\", \"threads\": %d, \"weight\": %g, \"ok\": 0}\n",
+                   i, format_size(configs[i].size).c_str(), configs[i].threads, configs[i].weight);
+            continue;
+        }
+        printf("{\"config\": %zu, \"size\": \"%s\", \"threads\": %d, \"weight\": %g, \"ok\": 1, "
+               "\"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu, \"max_rss\": %zu}\n",
+               i, format_size(configs[i].size).c_str(), configs[i].threads, configs[i].weight,
+               r.time, r.peak_mem, r.allocs, r.max_rss);
+        if (r.allocs > allocs) allocs = r.allocs;
+        if (r.max_rss > max_rss) max_rss = r.max_rss;
+    }
+    if (all_ok) {
+        printf("{\"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu, \"max_rss\": %zu}\n",
+               aggregate_time(configs, results), aggregate_peak_mem(results), allocs, max_rss);
+    } else {
+        printf("{\"ok\": 0, \"peak_mem\": %zu}\n", aggregate_peak_mem(results));
+    }
+    fflush(stdout);
+}
+
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef AUTOTUNE_HARNESS_H
+#define AUTOTUNE_HARNESS_H
+
+// The timing harness behind _autotune_timing_stub: binds and fills the
+// pipeline's inputs, times realizations and reports them as one line of
+// JSON on stdout.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "hugepages.h"
+#include "inputs.h"
+#include "memory.h"
+#include "numa.h"
+#include "stats.h"
+
+namespace autotune {
+
+inline double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// A size as written on command lines: "2048,2048,3" or "2048x2048x3"
+inline std::vector<int> parse_size(const char *s) {
+    std::vector<int> size;
+    while (*s) {
+        size.push_back(atoi(s));
+        while (*s && *s != ',' && *s != 'x') s++;
+        if (*s) s++;
+    }
+    return size;
+}
+
+struct Result {
+    double time;                  // fastest trial, in seconds
+    std::vector<double> samples;  // every trial, in the order they ran
+    size_t peak_mem;              // high-water mark of the pipeline's own allocations
+    size_t allocs;                // allocations made by one realization
+    size_t max_rss;               // peak resident set of the whole process
+};
+
+// func must have a single output, not a Tuple: exits with an error
+// otherwise
+inline void _check_single_output(Halide::Func &func) {
+    if (func.output_types().size() != 1) {
+        fprintf(stderr, "%s has %d outputs, the harness times single-output Funcs only\n", func.name().c_str(),
+                (int)func.output_types().size());
+        exit(1);
+    }
+}
+
+// Allocate an output of the given size (up to 4 dimensions) and bind
+// freshly allocated inputs big enough for it, deterministically filled
+// unless fill is false. Inputs bound by an earlier call are dropped
+// first. func must have a single output, not a Tuple; the process exits
+// with an error otherwise.
+inline Halide::Buffer bind(Halide::Func &func, const std::vector<int> &size, uint32_t seed = 0, bool fill = true) {
+    _check_single_output(func);
+    Halide::Type out_type = func.output_types()[0];
+    int n[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < size.size() && i < 4; i++) n[i] = size[i];
+    Halide::Buffer output(out_type, n[0], n[1], n[2], n[3], NULL, "output");
+
+    unbind_inputs(func);
+    func.infer_input_bounds(output);
+    if (fill) fill_inputs(func, seed);
+    return output;
+}
+
+// bind() for an output whose region the schedule decides: a bounds query
+// on an output of the given size with no host first, then the output
+// allocated at the mins and extents the query left in it (larger where a
+// split rounds the size up) and the inputs bound for that. What the
+// interpolate invalid-schedule repros' own stubs did.
+inline Halide::Buffer bind_inferred(Halide::Func &func, const std::vector<int> &size, uint32_t seed = 0,
+                                    bool fill = true) {
+    _check_single_output(func);
+    Halide::Type out_type = func.output_types()[0];
+    buffer_t query;
+    memset(&query, 0, sizeof(query));
+    query.elem_size = out_type.bytes();
+    int stride = 1;
+    for (size_t i = 0; i < size.size() && i < 4; i++) {
+        query.extent[i] = size[i];
+        query.stride[i] = stride;
+        stride *= size[i];
+    }
+    Halide::Buffer inferred(out_type, &query);
+    unbind_inputs(func);
+    func.infer_input_bounds(inferred);
+
+    const buffer_t *q = inferred.raw_buffer();
+    Halide::Buffer output(out_type, q->extent[0], q->extent[1], q->extent[2], q->extent[3], NULL, "output");
+    output.set_min(q->min[0], q->min[1], q->min[2], q->min[3]);
+    unbind_inputs(func);
+    func.infer_input_bounds(output);
+    if (fill) fill_inputs(func, seed);
+    return output;
+}
+
+// One element of a buffer of type t, as a double
+inline double _element(const uint8_t *p, Halide::Type t) {
+    if (t.is_float()) return t.bits == 32 ? *(const float *)p : *(const double *)p;
+    switch (t.bits) {
+    case 8: return *(const uint8_t *)p;
+    case 16: return *(const uint16_t *)p;
+    case 32: return *(const uint32_t *)p;
+    default: return (double)*(const uint64_t *)p;
+    }
+}
+
+// Largest absolute difference between two outputs of the same type and
+// extents, e.g. a pipeline's under two schedules. Elements that are NaN
+// in both match; infinite if the shapes or types differ or only one of
+// them is NaN.
+inline double max_difference(Halide::Buffer a, Halide::Buffer b) {
+    const buffer_t *p = a.raw_buffer(), *q = b.raw_buffer();
+    Halide::Type t = a.type();
+    if (t != b.type()) return INFINITY;
+    int ext[4];
+    for (int i = 0; i < 4; i++) {
+        if (p->extent[i] != q->extent[i]) return INFINITY;
+        ext[i] = p->extent[i] ? p->extent[i] : 1;
+    }
+    double max = 0;
+    for (int w = 0; w < ext[3]; w++) {
+        for (int z = 0; z < ext[2]; z++) {
+            for (int y = 0; y < ext[1]; y++) {
+                for (int x = 0; x < ext[0]; x++) {
+                    double u = _element(p->host + ((size_t)x * p->stride[0] + (size_t)y * p->stride[1] +
+                                                   (size_t)z * p->stride[2] + (size_t)w * p->stride[3]) * p->elem_size, t);
+                    double v = _element(q->host + ((size_t)x * q->stride[0] + (size_t)y * q->stride[1] +
+                                                   (size_t)z * q->stride[2] + (size_t)w * q->stride[3]) * q->elem_size, t);
+                    if (u == v || (u != u && v != v)) continue;
+                    double d = fabs(u - v);
+                    if (d != d) return INFINITY;
+                    if (d > max) max = d;
+                }
+            }
+        }
+    }
+    return max;
+}
+
+// JIT-compile func with one of the allocators in memory.h, numa.h and
+// hugepages.h, all of which keep the counts in alloc_stats()
+inline void compile(Halide::Func &func, Allocator allocator = Counting) {
+    if (allocator == Retaining) {
+        func.set_custom_allocator(retaining_malloc, retaining_free);
+    } else if (allocator == Pooled) {
+        func.set_custom_allocator(pooled_malloc, pooled_free);
+    } else if (allocator == Numa) {
+        func.set_custom_allocator(numa_malloc, numa_free);
+    } else if (allocator == HugePages) {
+        func.set_custom_allocator(huge_malloc, huge_free);
+    } else {
+        func.set_custom_allocator(counting_malloc, counting_free);
+    }
+    func.compile_jit();
+}
+
+// Compile func and bind it for the given size. Compilation and all
+// allocation of inputs and outputs happen here, outside the timed region.
+inline Halide::Buffer prepare(Halide::Func &func, const std::vector<int> &size, uint32_t seed = 0) {
+    compile(func);
+    return bind(func, size, seed);
+}
+
+inline double realize_once(Halide::Func &func, Halide::Buffer output) {
+    double t1 = now();
+    func.realize(output);
+    return now() - t1;
+}
+
+// Run trials realizations into output and keep the fastest. A nonzero
+// limit arms an alarm for the first trial, so a pathological schedule is
+// killed by SIGALRM instead of running forever.
+inline Result measure(Halide::Func &func, Halide::Buffer output, int trials, unsigned int limit = 0) {
+    Result r;
+    r.peak_mem = 0;
+    r.allocs = 0;
+    alarm(limit);
+    for (int i = 0; i < trials; i++) {
+        reset_alloc_stats();
+        r.samples.push_back(realize_once(func, output));
+        alarm(0); // disable alarm
+        if (alloc_stats().peak > r.peak_mem) r.peak_mem = alloc_stats().peak;
+        r.allocs = alloc_stats().count;
+    }
+    r.time = minimum(r.samples);
+    r.max_rss = max_rss_bytes();
+    return r;
+}
+
+inline void print_result(const Result &r) {
+    printf("{\"time\": %.10f, \"peak_mem\": %zu, \"allocs\": %zu, \"alloc_rate\": %.0f, \"max_rss\": %zu}\n",
+           r.time, r.peak_mem, r.allocs, r.time > 0 ? r.allocs / r.time : 0, r.max_rss);
+    fflush(stdout);
+}
+
+// Persistent mode for tools/ab_compare. Announce readiness once
+// everything is compiled and bound, then time one realization per "run"
+// line on stdin until "quit" or end of input. The driver decides when
+// each trial happens, so it can interleave two processes.
+inline void serve(Halide::Func &func, Halide::Buffer output, unsigned int limit = 0) {
+    printf("{\"ready\": 1}\n");
+    fflush(stdout);
+    char line[256];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (strncmp(line, "quit", 4) == 0) break;
+        if (strncmp(line, "run", 3) != 0) continue;
+        print_result(measure(func, output, 1, limit));
+    }
+}
+
+}
+
+#endif
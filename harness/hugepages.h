@@ -0,0 +1,173 @@
+#ifndef AUTOTUNE_HUGEPAGES_H
+#define AUTOTUNE_HUGEPAGES_H
+
+// Huge pages for the large blocks a pipeline allocates. A 2048x2048x4
+// float intermediate is 64 MB, 16384 pages of 4 KB, far more than the
+// dTLB maps; a schedule that walks it across its storage order (rows in
+// the loops, reorder_storage(c, y, x) in memory) lands on another page at
+// every step and misses the dTLB on most accesses. In 2 MB pages the
+// same block is 32 of them.
+//
+// huge_malloc/huge_free (compile(func, HugePages)) map blocks of
+// huge_threshold() bytes and more directly, aligned to the huge page
+// size, and back them by huge_page_mode():
+//   Transparent  madvise(MADV_HUGEPAGE), for the kernel's transparent
+//                huge pages, which must be enabled as "always" or
+//                "madvise" in /sys/kernel/mm/transparent_hugepage/enabled
+//   HugeTLB      MAP_HUGETLB, from the pages reserved in vm.nr_hugepages,
+//                or Transparent once those run out
+// Smaller blocks come from counting_malloc. Neither mode is guaranteed
+// to get huge pages, so with huge_check() set, huge_free looks up how
+// much of each block the kernel actually backed with them before
+// unmapping it (slow: it reads /proc/self/smaps). Nothing in here
+// depends on Halide.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "memory.h"
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+namespace autotune {
+
+enum HugePageMode { Transparent, HugeTLB };
+
+inline HugePageMode &huge_page_mode() {
+    static HugePageMode mode = Transparent;
+    return mode;
+}
+
+// Set both before the pipeline allocates anything
+inline size_t &huge_threshold() {
+    static size_t threshold = 2 << 20;
+    return threshold;
+}
+
+inline bool &huge_check() {
+    static bool check = false;
+    return check;
+}
+
+struct HugeStats {
+    std::atomic<size_t> blocks;      // blocks huge_malloc mapped itself
+    std::atomic<size_t> fallbacks;   // HugeTLB blocks that got transparent huge pages instead
+    std::atomic<size_t> checked;     // bytes of blocks freed with huge_check() set
+    std::atomic<size_t> huge_bytes;  // of those, bytes that were in huge pages
+};
+
+inline HugeStats &huge_stats() {
+    static HugeStats stats;
+    return stats;
+}
+
+inline void reset_huge_stats() {
+    HugeStats &s = huge_stats();
+    s.blocks = s.fallbacks = s.checked = s.huge_bytes = 0;
+}
+
+// Hugepagesize from /proc/meminfo, 2 MB if it isn't there
+inline size_t huge_page_size() {
+    static size_t size = 0;
+    if (!size) {
+        size = 2 << 20;
+        FILE *f = fopen("/proc/meminfo", "r");
+        char line[256];
+        unsigned long kb;
+        while (f && fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) size = kb * 1024;
+        }
+        if (f) fclose(f);
+    }
+    return size;
+}
+
+// Bytes of the mapping containing addr backed by huge pages, of either
+// kind, as /proc/self/smaps reports them
+inline size_t _smaps_huge_bytes(const void *addr) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    char line[512];
+    bool inside = false;
+    size_t kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end, n;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (inside) break;
+            inside = start <= (uintptr_t)addr && (uintptr_t)addr < end;
+        } else if (inside && (sscanf(line, "AnonHugePages: %lu kB", &n) == 1 ||
+                              sscanf(line, "Private_Hugetlb: %lu kB", &n) == 1 ||
+                              sscanf(line, "Shared_Hugetlb: %lu kB", &n) == 1)) {
+            kb += n;
+        }
+    }
+    fclose(f);
+    return kb * 1024;
+}
+
+// Blocks start one huge page into a transparent mapping (with the header
+// on the small page before them) or just past the header in a HugeTLB
+// one. The header holds the size, as for counting_malloc, then the
+// mapping's start and length.
+inline void *huge_malloc(void *user_context, size_t size) {
+    if (size < huge_threshold()) return counting_malloc(user_context, size);
+    size_t huge = huge_page_size();
+    uint8_t *base = NULL, *data = NULL;
+    size_t length = 0;
+    if (huge_page_mode() == HugeTLB) {
+        length = (size + _alloc_header + huge - 1) / huge * huge;
+        void *m = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (m != MAP_FAILED) {
+            base = (uint8_t *)m;
+            data = base + _alloc_header;
+        } else {
+            huge_stats().fallbacks++;
+        }
+    }
+    if (!data) {
+        size_t bytes = (size + huge - 1) / huge * huge;
+        length = bytes + 2 * huge;
+        void *m = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) return NULL;
+        base = (uint8_t *)m;
+        data = (uint8_t *)(((uintptr_t)base + huge) / huge * huge);
+        madvise(data, bytes, MADV_HUGEPAGE);
+    }
+    size_t *header = (size_t *)(data - _alloc_header);
+    header[0] = size;
+    header[1] = (size_t)base;
+    header[2] = length;
+    huge_stats().blocks++;
+    _note_alloc(size);
+    return data;
+}
+
+inline void huge_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    size_t *header = (size_t *)((uint8_t *)ptr - _alloc_header);
+    if (header[0] < huge_threshold()) {
+        counting_free(user_context, ptr);
+        return;
+    }
+    alloc_stats().current -= header[0];
+    if (huge_check()) {
+        huge_stats().checked += header[0];
+        huge_stats().huge_bytes += std::min(header[0], _smaps_huge_bytes(ptr));
+    }
+    munmap((void *)header[1], header[2]);
+}
+
+}
+
+#endif
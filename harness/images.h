@@ -0,0 +1,233 @@
+#ifndef AUTOTUNE_IMAGES_H
+#define AUTOTUNE_IMAGES_H
+
+// Float images in files, mapped straight into Halide::Buffers without
+// copying, so that benchmarks can run on real photographs at production
+// sizes for the price of an mmap.
+//
+// Two formats. Raw files are the elements of a dense planar layout (x
+// innermost, then y, then channels) with no header; the caller supplies
+// the extents. PFM files (Portable Float Map: "PF" for RGB, "Pf" for
+// grey, little-endian) keep rows bottom to top with RGB interleaved, so
+// their buffers have a negative y stride and, for RGB, channels as
+// dimension 0: (c, x, y), the layout of channel-innermost inputs. The
+// writer pads the header so that the data is float aligned, and readers
+// of files that aren't fall back to a copy. Bound to a pipeline that
+// reads RGBA, such as interpolate, an RGB PFM file is copied into the
+// pipeline's layout with an opaque alpha channel added.
+
+#include <Halide.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "inputs.h"
+#include "stream.h"
+
+namespace autotune {
+
+struct MappedImage {
+    MappedFile file;
+    Halide::Buffer buffer;
+    Halide::Buffer copy;  // what buffer points into when the file couldn't be used in place
+};
+
+inline void unmap_image(MappedImage &m) {
+    m.buffer = Halide::Buffer();
+    m.copy = Halide::Buffer();
+    unmap_file(m.file);
+}
+
+// A raw planar file of the given extents (up to 4) and type
+inline bool load_raw(const std::string &path, Halide::Type t, const std::vector<int> &extents, MappedImage &m) {
+    std::vector<int> e(4, 0), order;
+    for (size_t i = 0; i < extents.size() && i < 4; i++) {
+        e[i] = extents[i];
+        order.push_back(i);
+    }
+    buffer_t layout;
+    if (!raw_layout(t, e, order, layout) || !map_file(path, layout_bytes(layout), false, m.file)) return false;
+    layout.host = m.file.data;
+    m.buffer = Halide::Buffer(t, &layout);
+    return true;
+}
+
+// The buffer_t of a PFM image of w x h with the given channels whose
+// first (bottom) row starts at data
+inline buffer_t _pfm_layout(int w, int h, int channels, uint8_t *data) {
+    buffer_t b;
+    memset(&b, 0, sizeof(b));
+    b.elem_size = 4;
+    int d = 0;
+    if (channels > 1) {
+        b.extent[d] = channels;
+        b.stride[d++] = 1;
+    }
+    b.extent[d] = w;
+    b.stride[d++] = channels;
+    b.extent[d] = h;
+    b.stride[d] = -w * channels;
+    b.host = data + (size_t)(h - 1) * w * channels * 4;
+    return b;
+}
+
+// Map a PFM file. Fails on files that aren't PFM or are big-endian.
+inline bool load_pfm(const std::string &path, MappedImage &m) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char header[256];
+    size_t n = fread(header, 1, sizeof(header) - 1, f);
+    fclose(f);
+    header[n] = 0;
+
+    char magic[3];
+    int w, h, end = 0;
+    double scale;
+    if (sscanf(header, "%2s %d %d %lf%n", magic, &w, &h, &scale, &end) != 4 || end >= (int)n ||
+        (strcmp(magic, "PF") != 0 && strcmp(magic, "Pf") != 0) || w <= 0 || h <= 0 || scale >= 0) {
+        return false;
+    }
+    int channels = magic[1] == 'F' ? 3 : 1;
+    size_t offset = end + 1, bytes = (size_t)w * h * channels * 4;
+    if (!map_file(path, offset + bytes, false, m.file)) return false;
+
+    if (offset % 4 == 0) {
+        buffer_t b = _pfm_layout(w, h, channels, m.file.data + offset);
+        m.buffer = Halide::Buffer(Halide::Float(32), &b);
+        return true;
+    }
+    // Misaligned floats: copy them into memory of our own, bottom row
+    // first like the file, and let the mapping go
+    m.copy = channels > 1 ? Halide::Buffer(Halide::Float(32), channels, w, h) : Halide::Buffer(Halide::Float(32), w, h);
+    memcpy(m.copy.host_ptr(), m.file.data + offset, bytes);
+    unmap_file(m.file);
+    buffer_t b = _pfm_layout(w, h, channels, (uint8_t *)m.copy.host_ptr());
+    m.buffer = Halide::Buffer(Halide::Float(32), &b);
+    return true;
+}
+
+// Create a PFM file of w x h with 1 or 3 channels, mapped writable: a
+// pipeline realized into m.buffer writes the file directly.
+inline bool create_pfm(const std::string &path, int w, int h, int channels, MappedImage &m) {
+    if (channels != 1 && channels != 3) return false;
+    // Pad the scale with zeros until the data is float aligned
+    std::string header = std::string(channels == 3 ? "PF" : "Pf") + "\n" + std::to_string(w) + " " +
+                         std::to_string(h) + "\n-1.";
+    while ((header.size() + 1) % 4) header += "0";
+    header += "\n";
+    size_t bytes = (size_t)w * h * channels * 4;
+    if (!map_file(path, header.size() + bytes, true, m.file)) return false;
+    memcpy(m.file.data, header.data(), header.size());
+    buffer_t b = _pfm_layout(w, h, channels, m.file.data + header.size());
+    m.buffer = Halide::Buffer(Halide::Float(32), &b);
+    return true;
+}
+
+// Write a float image of (x, y) or (x, y, c) with 1 or 3 channels to a
+// PFM file
+inline bool save_pfm(const std::string &path, Halide::Buffer image) {
+    const buffer_t *src = image.raw_buffer();
+    int channels = src->extent[2] ? src->extent[2] : 1;
+    MappedImage m;
+    if (image.type() != Halide::Float(32) || !create_pfm(path, src->extent[0], src->extent[1], channels, m)) {
+        return false;
+    }
+    const buffer_t *dst = m.buffer.raw_buffer();
+    int d = channels > 1 ? 1 : 0;
+    ptrdiff_t cs = d ? dst->stride[0] : 0, xs = dst->stride[d], ys = dst->stride[d + 1];
+    for (int c = 0; c < channels; c++) {
+        for (int y = 0; y < src->extent[1]; y++) {
+            for (int x = 0; x < src->extent[0]; x++) {
+                float v = ((const float *)src->host)[(ptrdiff_t)x * src->stride[0] + (ptrdiff_t)y * src->stride[1] +
+                                                     (ptrdiff_t)c * src->stride[2]];
+                ((float *)dst->host)[c * cs + x * xs + y * ys] = v;
+            }
+        }
+    }
+    unmap_image(m);
+    return true;
+}
+
+inline bool _is_pfm(const std::string &path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".pfm") == 0;
+}
+
+// A PFM (by extension) or raw file, the raw one read with the given type
+// and extents
+inline bool load_image(const std::string &path, Halide::Type t, const std::vector<int> &extents, MappedImage &m) {
+    if (_is_pfm(path)) return load_pfm(path, m);
+    return load_raw(path, t, extents, m);
+}
+
+// Replace the RGB PFM image in m, (c, x, y), by a copy in the RGBA layout
+// want has, planar (x, y, c) or interleaved (c, x, y), with alpha 1 (the
+// interpolate pipeline treats alpha as coverage). The file is unmapped.
+// Returns false, leaving m alone, if want isn't 4 channels of the same
+// width and height.
+inline bool _expand_rgb(MappedImage &m, const buffer_t *want) {
+    const buffer_t *rgb = m.buffer.raw_buffer();
+    int w = rgb->extent[1], h = rgb->extent[2];
+    bool interleaved = want->extent[0] == 4 && want->extent[1] == w && want->extent[2] == h;
+    bool planar = want->extent[0] == w && want->extent[1] == h && want->extent[2] == 4;
+    if (want->extent[3] || (!interleaved && !planar)) return false;
+    Halide::Buffer rgba = interleaved ? Halide::Buffer(Halide::Float(32), 4, w, h)
+                                      : Halide::Buffer(Halide::Float(32), w, h, 4);
+    const buffer_t *dst = rgba.raw_buffer();
+    int cd = interleaved ? 0 : 2, xd = interleaved ? 1 : 0;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const float *from = (const float *)rgb->host + (ptrdiff_t)x * rgb->stride[1] + (ptrdiff_t)y * rgb->stride[2];
+            float *to = (float *)dst->host + (ptrdiff_t)x * dst->stride[xd] + (ptrdiff_t)y * dst->stride[xd + 1];
+            for (int c = 0; c < 4; c++) to[(ptrdiff_t)c * dst->stride[cd]] = c < 3 ? from[c * rgb->stride[0]] : 1.0f;
+        }
+    }
+    m.buffer = rgba;
+    m.copy = Halide::Buffer();
+    unmap_file(m.file);
+    return true;
+}
+
+// Bind the file at path as func's input in place of the buffer bind()
+// left there, which sets what the file must hold: a raw file is read
+// with that buffer's type and extents, and a PFM file must have them,
+// or be RGB where they are RGBA (see _expand_rgb), which costs a copy.
+// The mapped buffer takes over the bound one's mins. Only the first of
+// several inputs is replaced. Prints why and returns false if the file
+// doesn't fit.
+inline bool bind_file(Halide::Func &func, const std::string &path, MappedImage &m) {
+    std::vector<Halide::Internal::Parameter> params = find_input_params(func);
+    Halide::Buffer bound = params.empty() ? Halide::Buffer() : params[0].get_buffer();
+    if (!bound.defined()) {
+        fprintf(stderr, "%s: the pipeline has no bound input\n", path.c_str());
+        return false;
+    }
+    const buffer_t *want = bound.raw_buffer();
+    std::vector<int> extents(want->extent, want->extent + 4);
+    if (!load_image(path, bound.type(), extents, m)) {
+        fprintf(stderr, "%s: can't map it as %dx%dx%dx%d %s\n", path.c_str(), extents[0], extents[1], extents[2],
+                extents[3], bound.type().is_float() ? "float" : "integer");
+        return false;
+    }
+    buffer_t *got = m.buffer.raw_buffer();
+    if (_is_pfm(path) && got->extent[0] == 3 && memcmp(got->extent, want->extent, sizeof(got->extent)) != 0 &&
+        _expand_rgb(m, want)) {
+        got = m.buffer.raw_buffer();
+    }
+    if (m.buffer.type() != bound.type() || memcmp(got->extent, want->extent, sizeof(got->extent)) != 0) {
+        fprintf(stderr, "%s: %dx%dx%d, the pipeline reads %dx%dx%d\n", path.c_str(), got->extent[0],
+                got->extent[1], got->extent[2], want->extent[0], want->extent[1], want->extent[2]);
+        unmap_image(m);
+        return false;
+    }
+    memcpy(got->min, want->min, sizeof(got->min));
+    params[0].set_buffer(m.buffer);
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef AUTOTUNE_INPUTS_H
+#define AUTOTUNE_INPUTS_H
+
+// Finds the ImageParams a pipeline reads, so the harness can bind them
+// and fill them with reproducible contents.
+
+#include <Halide.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace autotune {
+
+class _FindInputs : public Halide::Internal::IRVisitor {
+public:
+    std::map<std::string, Halide::Internal::Parameter> params;
+
+    using Halide::Internal::IRVisitor::visit;
+
+    void visit(const Halide::Internal::Call *op) {
+        Halide::Internal::IRVisitor::visit(op);
+        if (op->call_type == Halide::Internal::Call::Image && op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+    }
+};
+
+// Every ImageParam referenced anywhere in the pipeline that computes func
+inline std::vector<Halide::Internal::Parameter> find_input_params(Halide::Func func) {
+    std::map<std::string, Halide::Internal::Function> funcs =
+        Halide::Internal::find_transitive_calls(func.function());
+    funcs[func.name()] = func.function();
+
+    _FindInputs finder;
+    for (std::map<std::string, Halide::Internal::Function>::iterator it = funcs.begin();
+         it != funcs.end(); ++it) {
+        const Halide::Internal::Function &f = it->second;
+        for (size_t i = 0; i < f.values().size(); i++) {
+            f.values()[i].accept(&finder);
+        }
+        if (f.has_reduction_definition()) {
+            for (size_t i = 0; i < f.reduction_values().size(); i++) {
+                f.reduction_values()[i].accept(&finder);
+            }
+            for (size_t i = 0; i < f.reduction_args().size(); i++) {
+                f.reduction_args()[i].accept(&finder);
+            }
+        }
+    }
+
+    std::vector<Halide::Internal::Parameter> result;
+    for (std::map<std::string, Halide::Internal::Parameter>::iterator it = finder.params.begin();
+         it != finder.params.end(); ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+// Drop the buffers bound to the pipeline's inputs, so the next
+// infer_input_bounds call allocates fresh ones for a new output size.
+inline void unbind_inputs(Halide::Func func) {
+    std::vector<Halide::Internal::Parameter> params = find_input_params(func);
+    for (size_t i = 0; i < params.size(); i++) {
+        params[i].set_buffer(Halide::Buffer());
+    }
+}
+
+inline uint32_t _hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// Fill b with a pattern that depends only on the seed and each element's
+// coordinates, never on strides or allocation order, so two processes
+// (or two Halide builds) see exactly the same input. Floating point
+// values are in [0, 1]; integers span the whole range of their type.
+inline void fill_buffer(Halide::Buffer b, uint32_t seed) {
+    buffer_t *buf = b.raw_buffer();
+    if (!buf || !buf->host) return;
+    Halide::Type t = b.type();
+    int ext[4], str[4];
+    for (int i = 0; i < 4; i++) {
+        ext[i] = buf->extent[i] ? buf->extent[i] : 1;
+        str[i] = buf->extent[i] ? buf->stride[i] : 0;
+    }
+    for (int w = 0; w < ext[3]; w++) {
+        for (int z = 0; z < ext[2]; z++) {
+            for (int y = 0; y < ext[1]; y++) {
+                for (int x = 0; x < ext[0]; x++) {
+                    uint32_t h = _hash(seed ^ _hash((uint32_t)(buf->min[0] + x) ^
+                                       _hash((uint32_t)(buf->min[1] + y) ^
+                                       _hash((uint32_t)(buf->min[2] + z) ^
+                                       _hash((uint32_t)(buf->min[3] + w))))));
+                    size_t idx = (size_t)x * str[0] + (size_t)y * str[1] +
+                                 (size_t)z * str[2] + (size_t)w * str[3];
+                    uint8_t *p = buf->host + idx * buf->elem_size;
+                    if (t.is_float() && t.bits == 32) {
+                        *(float *)p = (h >> 8) * (1.0f / (1 << 24));
+                    } else if (t.is_float() && t.bits == 64) {
+                        *(double *)p = (h >> 8) * (1.0 / (1 << 24));
+                    } else if (t.bits == 8) {
+                        *(uint8_t *)p = (uint8_t)h;
+                    } else if (t.bits == 16) {
+                        *(uint16_t *)p = (uint16_t)h;
+                    } else if (t.bits == 32) {
+                        *(uint32_t *)p = h;
+                    } else if (t.bits == 64) {
+                        *(uint64_t *)p = ((uint64_t)h << 32) | _hash(h);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Fill padded, whatever region it covers, from image with the edge
+// replicated: element (x, y, ...) is image's element at each coordinate
+// clamped to [lo[i], hi[i]], by default image's own extent. Binds an
+// unclamped (pre-padded) pipeline's input so that it sees the same image
+// a clamped one would.
+inline void pad_from(Halide::Buffer padded, Halide::Buffer image,
+                     std::vector<int> lo = std::vector<int>(), std::vector<int> hi = std::vector<int>()) {
+    buffer_t *dst = padded.raw_buffer();
+    const buffer_t *src = image.raw_buffer();
+    if (!dst || !dst->host || !src || !src->host || dst->elem_size != src->elem_size) return;
+    int ext[4];
+    for (int i = 0; i < 4; i++) {
+        ext[i] = dst->extent[i] ? dst->extent[i] : 1;
+        if ((int)lo.size() <= i) lo.push_back(src->min[i]);
+        if ((int)hi.size() <= i) hi.push_back(src->min[i] + (src->extent[i] ? src->extent[i] : 1) - 1);
+    }
+    int c[4];
+    for (int w = 0; w < ext[3]; w++) {
+        for (int z = 0; z < ext[2]; z++) {
+            for (int y = 0; y < ext[1]; y++) {
+                for (int x = 0; x < ext[0]; x++) {
+                    int at[4] = {x, y, z, w};
+                    size_t from = 0, to = 0;
+                    for (int i = 0; i < 4; i++) {
+                        c[i] = dst->min[i] + at[i];
+                        c[i] = c[i] < lo[i] ? lo[i] : c[i] > hi[i] ? hi[i] : c[i];
+                        from += (size_t)(c[i] - src->min[i]) * (src->extent[i] ? src->stride[i] : 0);
+                        to += (size_t)at[i] * (dst->extent[i] ? dst->stride[i] : 0);
+                    }
+                    memcpy(dst->host + to * dst->elem_size, src->host + from * src->elem_size, src->elem_size);
+                }
+            }
+        }
+    }
+}
+
+// Fill every input the pipeline has bound, with seeds that differ per
+// input but not between runs.
+inline void fill_inputs(Halide::Func func, uint32_t seed) {
+    std::vector<Halide::Internal::Parameter> params = find_input_params(func);
+    for (size_t i = 0; i < params.size(); i++) {
+        Halide::Buffer b = params[i].get_buffer();
+        if (b.defined()) fill_buffer(b, seed + (uint32_t)i);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef AUTOTUNE_MEMORY_H
+#define AUTOTUNE_MEMORY_H
+
+// Allocator hooks for Halide's set_custom_allocator that keep track of
+// how much memory a pipeline holds while it runs. Nothing in here
+// depends on Halide.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace autotune {
+
+struct AllocStats {
+    std::atomic<size_t> current;  // bytes live right now
+    std::atomic<size_t> peak;     // high-water mark of current
+    std::atomic<size_t> total;    // bytes handed out
+    std::atomic<size_t> count;    // number of allocations
+    std::atomic<size_t> reused;   // of those, served from retained or pooled blocks
+};
+
+inline AllocStats &alloc_stats() {
+    static AllocStats stats;
+    return stats;
+}
+
+// Forget everything except what is live, e.g. between trials.
+inline void reset_alloc_stats() {
+    AllocStats &s = alloc_stats();
+    s.peak = s.current.load();
+    s.total = 0;
+    s.count = 0;
+    s.reused = 0;
+}
+
+// halide_malloc hands out 32-byte aligned blocks; keep that guarantee
+// and stash the block size in the padding in front of it.
+static const size_t _alloc_header = 32;
+
+inline void _note_alloc(size_t size) {
+    AllocStats &s = alloc_stats();
+    size_t now = (s.current += size);
+    size_t peak = s.peak.load();
+    while (now > peak && !s.peak.compare_exchange_weak(peak, now)) {}
+    s.total += size;
+    s.count++;
+}
+
+inline size_t _page_size() {
+    static size_t page = sysconf(_SC_PAGESIZE);
+    return page;
+}
+
+inline void *counting_malloc(void *user_context, size_t size) {
+    void *base = NULL;
+    if (posix_memalign(&base, _alloc_header, size + _alloc_header) != 0) {
+        return NULL;
+    }
+    *(size_t *)base = size;
+    _note_alloc(size);
+    return (uint8_t *)base + _alloc_header;
+}
+
+inline void counting_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    void *base = (uint8_t *)ptr - _alloc_header;
+    alloc_stats().current -= *(size_t *)base;
+    free(base);
+}
+
+// Blocks freed through retaining_free, by size, for retaining_malloc to
+// hand out again. A pipeline realized over and over at the same size
+// asks for the same sizes every time, so from the second realization on
+// its compute_root intermediates come back already allocated and faulted
+// in, the way a long-lived process that pools its buffers would see them.
+struct _Retained {
+    std::mutex lock;
+    std::multimap<size_t, void *> blocks;
+};
+
+inline _Retained &_retained() {
+    static _Retained r;
+    return r;
+}
+
+inline void *retaining_malloc(void *user_context, size_t size) {
+    _Retained &r = _retained();
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        std::multimap<size_t, void *>::iterator it = r.blocks.find(size);
+        if (it != r.blocks.end()) {
+            void *base = it->second;
+            r.blocks.erase(it);
+            _note_alloc(size);
+            alloc_stats().reused++;
+            return (uint8_t *)base + _alloc_header;
+        }
+    }
+    return counting_malloc(user_context, size);
+}
+
+inline void retaining_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    void *base = (uint8_t *)ptr - _alloc_header;
+    size_t size = *(size_t *)base;
+    alloc_stats().current -= size;
+    _Retained &r = _retained();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.blocks.insert(std::make_pair(size, base));
+}
+
+// Free every retained block
+inline void release_retained() {
+    _Retained &r = _retained();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (std::multimap<size_t, void *>::iterator it = r.blocks.begin(); it != r.blocks.end(); ++it) {
+        free(it->second);
+    }
+    r.blocks.clear();
+}
+
+// Size-classed pool for the small blocks that Funcs computed at inner
+// loop levels allocate and free once per iteration, millions of times a
+// realization. Classes are powers of two from 32 bytes to 64 KB, and
+// every thread keeps its own free list per class, so a block freed on a
+// thread goes to the next allocation of its class on that thread without
+// a lock. Larger blocks come from the system, as with counting_malloc.
+static const int _pool_classes = 12;
+static const size_t _pool_cached = 256;  // blocks kept per thread and class
+
+struct _PoolCache {
+    void *head[_pool_classes];  // linked through the word after the size in each header
+    size_t count[_pool_classes];
+
+    _PoolCache() {
+        for (int c = 0; c < _pool_classes; c++) {
+            head[c] = NULL;
+            count[c] = 0;
+        }
+    }
+
+    ~_PoolCache() {
+        for (int c = 0; c < _pool_classes; c++) {
+            while (head[c]) {
+                void *next = *(void **)((uint8_t *)head[c] + sizeof(size_t));
+                free(head[c]);
+                head[c] = next;
+            }
+        }
+    }
+};
+
+inline _PoolCache &_pool_cache() {
+    static thread_local _PoolCache cache;
+    return cache;
+}
+
+// Size class of a block of size bytes; _pool_classes if it has none
+inline int _pool_class(size_t size) {
+    int c = 0;
+    while (c < _pool_classes && ((size_t)32 << c) < size) c++;
+    return c;
+}
+
+inline void *pooled_malloc(void *user_context, size_t size) {
+    int c = _pool_class(size);
+    if (c == _pool_classes) return counting_malloc(user_context, size);
+    _PoolCache &p = _pool_cache();
+    void *base = p.head[c];
+    if (base) {
+        p.head[c] = *(void **)((uint8_t *)base + sizeof(size_t));
+        p.count[c]--;
+        alloc_stats().reused++;
+    } else if (posix_memalign(&base, _alloc_header, ((size_t)32 << c) + _alloc_header) != 0) {
+        return NULL;
+    }
+    *(size_t *)base = size;
+    _note_alloc(size);
+    return (uint8_t *)base + _alloc_header;
+}
+
+inline void pooled_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    void *base = (uint8_t *)ptr - _alloc_header;
+    size_t size = *(size_t *)base;
+    alloc_stats().current -= size;
+    int c = _pool_class(size);
+    _PoolCache &p = _pool_cache();
+    if (c == _pool_classes || p.count[c] == _pool_cached) {
+        free(base);
+        return;
+    }
+    *(void **)((uint8_t *)base + sizeof(size_t)) = p.head[c];
+    p.head[c] = base;
+    p.count[c]++;
+}
+
+// The allocators above, numa_malloc in numa.h and huge_malloc in
+// hugepages.h, for choosing one by value
+enum Allocator { Counting, Retaining, Pooled, Numa, HugePages };
+
+// Page faults this process has taken so far, minor and major
+inline size_t page_faults() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (size_t)(ru.ru_minflt + ru.ru_majflt);
+}
+
+// Peak resident set size of this process, in bytes
+inline size_t max_rss_bytes() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (size_t)ru.ru_maxrss * 1024;
+}
+
+}
+
+#endif
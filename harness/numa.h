@@ -0,0 +1,181 @@
+#ifndef AUTOTUNE_NUMA_H
+#define AUTOTUNE_NUMA_H
+
+// NUMA placement for the large blocks a pipeline allocates, its
+// compute_root intermediates, and the counters that show where its loads
+// were served from. By default the kernel puts each page on the node of
+// the thread that first touches it, so an intermediate written by a
+// serial loop, or by whichever threads happened to run first, ends up
+// read across the interconnect by the parallel loops that consume it.
+//
+// numa_malloc/numa_free (compile(func, Numa)) map blocks of _numa_min
+// bytes and more directly and place them by numa_policy():
+//   FirstTouch   the kernel's default
+//   Interleave   pages spread round robin over all nodes
+//   Partitioned  the block cut into numa_stripes() stripes per node, the
+//                k-th stripe on the (k mod nodes)-th node, to match a
+//                parallel loop over the rows split evenly between
+//                workers placed node by node, as the work pool in
+//                pool.h places them. One stripe per node suits a single
+//                plane; a planar image of c channels wants c stripes.
+// Smaller blocks come from counting_malloc. The policies are set with
+// the mbind system call and the topology read from sysfs, so nothing
+// here needs libnuma, or Halide. On one node every policy is first
+// touch.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "memory.h"
+#include "perf.h"
+
+namespace autotune {
+
+// CPUs or nodes listed in a sysfs file ("0-3,8-11"), empty if there is
+// no such file
+inline std::vector<int> _sys_list(const char *path) {
+    std::vector<int> list;
+    FILE *f = fopen(path, "r");
+    if (!f) return list;
+    int a, b;
+    while (fscanf(f, "%d", &a) == 1) {
+        b = a;
+        int c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%d", &b) != 1) break;
+            c = fgetc(f);
+        }
+        for (int i = a; i <= b; i++) list.push_back(i);
+        if (c != ',') break;
+    }
+    fclose(f);
+    return list;
+}
+
+// Nodes with memory, {0} without NUMA
+inline const std::vector<int> &numa_nodes() {
+    static std::vector<int> nodes;
+    if (nodes.empty()) {
+        nodes = _sys_list("/sys/devices/system/node/has_memory");
+        if (nodes.empty()) nodes = _sys_list("/sys/devices/system/node/online");
+        if (nodes.empty()) nodes.push_back(0);
+    }
+    return nodes;
+}
+
+// Every CPU, node by node, empty without NUMA
+inline std::vector<int> cpus_by_node() {
+    std::vector<int> cpus, nodes = _sys_list("/sys/devices/system/node/online");
+    for (size_t i = 0; i < nodes.size(); i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes[i]);
+        std::vector<int> node = _sys_list(path);
+        cpus.insert(cpus.end(), node.begin(), node.end());
+    }
+    return cpus;
+}
+
+enum NumaPolicy { FirstTouch, Interleave, Partitioned };
+
+inline NumaPolicy &numa_policy() {
+    static NumaPolicy policy = FirstTouch;
+    return policy;
+}
+
+inline int &numa_stripes() {
+    static int stripes = 1;
+    return stripes;
+}
+
+static const size_t _numa_min = 256 * 1024;
+static const int _mpol_preferred = 1, _mpol_interleave = 3;
+
+// Set the policy of [addr, addr + bytes) to mode over the given nodes.
+// Failure leaves the range to first touch.
+inline void _mbind(void *addr, size_t bytes, int mode, const int *nodes, size_t n) {
+    unsigned long mask[16];
+    memset(mask, 0, sizeof(mask));
+    for (size_t i = 0; i < n; i++) {
+        if (nodes[i] < (int)sizeof(mask) * 8) mask[nodes[i] / 64] |= 1UL << (nodes[i] % 64);
+    }
+    syscall(SYS_mbind, addr, bytes, mode, mask, sizeof(mask) * 8 + 1, 0);
+}
+
+// Blocks start one page into their mapping, page aligned, with the size
+// in the _alloc_header bytes in front of them as for counting_malloc
+inline void *numa_malloc(void *user_context, size_t size) {
+    if (size < _numa_min) return counting_malloc(user_context, size);
+    size_t page = _page_size(), bytes = (size + page - 1) / page * page;
+    void *base = mmap(NULL, bytes + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    uint8_t *data = (uint8_t *)base + page;
+    *(size_t *)(data - _alloc_header) = size;
+
+    const std::vector<int> &nodes = numa_nodes();
+    if (nodes.size() > 1 && numa_policy() == Interleave) {
+        _mbind(data, bytes, _mpol_interleave, &nodes[0], nodes.size());
+    } else if (nodes.size() > 1 && numa_policy() == Partitioned) {
+        size_t stripes = nodes.size() * (numa_stripes() < 1 ? 1 : numa_stripes()), pages = bytes / page;
+        for (size_t k = 0; k < stripes; k++) {
+            size_t b = pages * k / stripes, e = pages * (k + 1) / stripes;
+            if (e > b) _mbind(data + b * page, (e - b) * page, _mpol_preferred, &nodes[k % nodes.size()], 1);
+        }
+    }
+    _note_alloc(size);
+    return data;
+}
+
+inline void numa_free(void *user_context, void *ptr) {
+    if (!ptr) return;
+    size_t size = *(size_t *)((uint8_t *)ptr - _alloc_header);
+    if (size < _numa_min) {
+        counting_free(user_context, ptr);
+        return;
+    }
+    alloc_stats().current -= size;
+    size_t page = _page_size(), bytes = (size + page - 1) / page * page;
+    munmap((uint8_t *)ptr - page, bytes + page);
+}
+
+// Loads served from memory, and of those the ones served by another
+// node, as perf counts them (node-loads and node-load-misses), for this
+// thread and the threads it starts after open_node_counters. -1 where
+// the CPU or the kernel doesn't count them.
+struct NodeLoads {
+    long long loads, remote;
+};
+
+inline int *_node_counters() {
+    static int fds[2] = {-1, -1};
+    return fds;
+}
+
+// Start counting. Call before the first realization, so the thread
+// pools' workers inherit the counters. Returns false if neither counter
+// is available.
+inline bool open_node_counters() {
+    int *fds = _node_counters();
+    if (fds[0] < 0) fds[0] = open_cache_counter(PERF_COUNT_HW_CACHE_NODE, PERF_COUNT_HW_CACHE_OP_READ,
+                                                PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+    if (fds[1] < 0) fds[1] = open_cache_counter(PERF_COUNT_HW_CACHE_NODE, PERF_COUNT_HW_CACHE_OP_READ,
+                                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+    return fds[0] >= 0 || fds[1] >= 0;
+}
+
+inline NodeLoads read_node_counters() {
+    NodeLoads n;
+    n.loads = read_counter(_node_counters()[0]);
+    n.remote = read_counter(_node_counters()[1]);
+    return n;
+}
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef AUTOTUNE_PERF_H
+#define AUTOTUNE_PERF_H
+
+// Hardware cache event counters from perf_event_open, counted in user
+// space for this thread and every thread it starts after opening them,
+// so open them before the first realization starts the thread pools.
+// Where the CPU or the kernel (or a VM) doesn't provide an event, its
+// counter reads -1. Nothing in here depends on Halide.
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace autotune {
+
+// A counter of PERF_TYPE_HW_CACHE event cache | op << 8 | result << 16,
+// e.g. (PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+// PERF_COUNT_HW_CACHE_RESULT_MISS) for dTLB load misses. Returns -1 if
+// it can't be opened.
+inline int open_cache_counter(int cache, int op, int result) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = (uint64_t)cache | ((uint64_t)op << 8) | ((uint64_t)result << 16);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// The count so far, -1 for a counter that didn't open
+inline long long read_counter(int fd) {
+    long long v;
+    if (fd < 0 || read(fd, &v, sizeof(v)) != sizeof(v)) return -1;
+    return v;
+}
+
+}
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef AUTOTUNE_POOL_H
+#define AUTOTUNE_POOL_H
+
+// A work-stealing thread pool for Halide's parallel loops, installed in
+// place of the runtime's own pool with
+// func.set_custom_do_par_for(work_pool_do_par_for). Generated schedules
+// parallelize loops of very different sizes, and nest them across
+// compute_at levels; the runtime's pool hands out one iteration at a
+// time from a shared queue.
+//
+// Here each parallel loop is a job whose iterations start out split
+// evenly between the pool's workers (plus one share for the thread that
+// started it). A worker runs its share in chunks from the front, and
+// when it runs out steals half of what is left at the back of another
+// share, so an uneven loop evens out without a shared counter. Both ends
+// of a share are packed in one 64-bit word and moved with compare and
+// swap. The thread that starts a loop works on it too, so a loop nested
+// inside another's iteration always makes progress, and once there is
+// nothing left to take it sleeps until the iterations other workers took
+// are done, leaving its core to them. Workers are pinned
+// to one core each, in order node by node, so the shares of a loop over
+// rows line up with the NUMA nodes (see Partitioned in numa.h), and
+// count their busy time, so the idle time of a schedule's parallel loops
+// can be read off per worker. Nothing in here depends on Halide.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
+namespace autotune {
+
+struct WorkerStats {
+    double busy;    // seconds running loop iterations
+    double idle;    // seconds since the stats were reset, less busy
+    size_t chunks;  // chunks run
+    size_t steals;  // shares stolen from other workers
+};
+
+inline uint64_t _monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct _PoolJob {
+    void *user_context;
+    int (*f)(void *, int, uint8_t *);
+    uint8_t *closure;
+    int min, chunk, shares;
+    std::unique_ptr<std::atomic<uint64_t>[]> ranges;  // begin << 32 | end, per share
+    std::atomic<int> pending;                         // iterations not finished yet
+    std::atomic<int> result;                          // first nonzero result of f
+    std::mutex done_lock;
+    std::condition_variable done;                     // notified when pending reaches 0
+};
+
+struct _PoolCounters {
+    std::atomic<uint64_t> busy_ns, chunks, steals;
+};
+
+struct _Pool {
+    std::vector<std::thread> workers;
+    std::unique_ptr<_PoolCounters[]> counters;  // per worker, then one for outside threads
+    std::atomic<bool> started;
+    int chunks_per_share;
+    uint64_t reset_ns;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::vector<std::shared_ptr<_PoolJob> > jobs;
+    uint64_t generation;
+    bool stopping;
+
+    _Pool() : started(false), chunks_per_share(4), reset_ns(0), generation(0), stopping(false) {}
+
+    ~_Pool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+    }
+};
+
+inline _Pool &_pool() {
+    static _Pool pool;
+    return pool;
+}
+
+// Which worker this thread is: the pool's size for threads outside it
+inline int &_pool_slot() {
+    static thread_local int slot = -1;
+    return slot;
+}
+
+// How many chunks this thread is inside of: only the outermost counts
+// as busy, so nested loops aren't counted twice
+inline int &_pool_depth() {
+    static thread_local int depth = 0;
+    return depth;
+}
+
+// Take up to chunk iterations from the front of a share
+inline bool _take_front(std::atomic<uint64_t> &range, int chunk, int &b, int &e) {
+    uint64_t v = range.load();
+    for (;;) {
+        b = (int)(v >> 32);
+        int end = (int)(v & 0xffffffff);
+        if (b >= end) return false;
+        e = std::min(b + chunk, end);
+        if (range.compare_exchange_weak(v, ((uint64_t)e << 32) | (uint32_t)end)) return true;
+    }
+}
+
+// Take half of what is left of a share (all of it if that's one chunk)
+// from the back
+inline bool _steal_back(std::atomic<uint64_t> &range, int chunk, int &b, int &e) {
+    uint64_t v = range.load();
+    for (;;) {
+        int begin = (int)(v >> 32);
+        e = (int)(v & 0xffffffff);
+        if (begin >= e) return false;
+        int n = e - begin;
+        b = e - (n > chunk ? n / 2 : n);
+        if (range.compare_exchange_weak(v, ((uint64_t)begin << 32) | (uint32_t)b)) return true;
+    }
+}
+
+// Run job's iterations as the worker owning share slot until none are
+// left to take
+inline void _run_job(_PoolJob &job, int slot) {
+    _Pool &pool = _pool();
+    _PoolCounters &counters = pool.counters[slot];
+    int mine = slot < job.shares ? slot : job.shares - 1;
+    for (;;) {
+        int b, e;
+        if (!_take_front(job.ranges[mine], job.chunk, b, e)) {
+            bool stole = false;
+            for (int k = 1; k < job.shares && !stole; k++) {
+                int victim = (mine + k) % job.shares;
+                stole = _steal_back(job.ranges[victim], job.chunk, b, e);
+            }
+            if (!stole) return;
+            counters.steals++;
+            // Put what doesn't fit in this chunk in the (empty) share,
+            // where others can steal it in turn, unless another thread
+            // sharing the share got there first
+            uint64_t empty = job.ranges[mine].load();
+            if (e - b > job.chunk && (empty >> 32) >= (empty & 0xffffffff) &&
+                job.ranges[mine].compare_exchange_strong(empty, ((uint64_t)(b + job.chunk) << 32) | (uint32_t)e)) {
+                e = b + job.chunk;
+            }
+        }
+        uint64_t t1 = _pool_depth()++ ? 0 : _monotonic_ns();
+        for (int i = b; i < e; i++) {
+            int r = job.f(job.user_context, job.min + i, job.closure);
+            int ok = 0;
+            if (r != 0) job.result.compare_exchange_strong(ok, r);
+        }
+        if (--_pool_depth() == 0) counters.busy_ns += _monotonic_ns() - t1;
+        counters.chunks++;
+        if ((job.pending -= e - b) == 0) {
+            std::lock_guard<std::mutex> guard(job.done_lock);
+            job.done.notify_all();
+        }
+    }
+}
+
+inline void _pool_worker(int slot) {
+    _pool_slot() = slot;
+    _Pool &pool = _pool();
+    uint64_t seen = 0;
+    for (;;) {
+        std::vector<std::shared_ptr<_PoolJob> > jobs;
+        {
+            std::unique_lock<std::mutex> guard(pool.lock);
+            pool.wake.wait(guard, [&] { return pool.stopping || pool.generation != seen; });
+            if (pool.stopping) return;
+            seen = pool.generation;
+            jobs = pool.jobs;
+        }
+        for (size_t i = 0; i < jobs.size(); i++) _run_job(*jobs[i], slot);
+    }
+}
+
+// Start the pool with the given number of workers (0: HL_NUMTHREADS,
+// like the runtime's pool, or else one per core), each pinned to a core
+// if pin, the first ones on the first node's cores. Only the first call
+// has any effect.
+inline void start_work_pool(int threads = 0, bool pin = true, int chunks_per_share = 4) {
+    _Pool &pool = _pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    if (pool.started) return;
+    int cores = std::thread::hardware_concurrency();
+    if (cores < 1) cores = 1;
+    if (threads < 1 && getenv("HL_NUMTHREADS")) threads = atoi(getenv("HL_NUMTHREADS"));
+    if (threads < 1) threads = cores;
+    pool.chunks_per_share = chunks_per_share < 1 ? 1 : chunks_per_share;
+    pool.counters.reset(new _PoolCounters[threads + 1]);
+    for (int i = 0; i <= threads; i++) {
+        pool.counters[i].busy_ns = pool.counters[i].chunks = pool.counters[i].steals = 0;
+    }
+    pool.reset_ns = _monotonic_ns();
+    std::vector<int> cpus = cpus_by_node();
+    if (cpus.empty()) {
+        for (int i = 0; i < cores; i++) cpus.push_back(i);
+    }
+    for (int i = 0; i < threads; i++) {
+        pool.workers.push_back(std::thread(_pool_worker, i));
+        if (pin) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[i % cpus.size()], &set);
+            pthread_setaffinity_np(pool.workers.back().native_handle(), sizeof(set), &set);
+        }
+    }
+    pool.started = true;
+}
+
+// The do_par_for hook: run f(user_context, i, closure) for i in
+// [min, min + size) on the pool, and return the first nonzero result
+inline int work_pool_do_par_for(void *user_context, int (*f)(void *, int, uint8_t *), int min, int size,
+                                uint8_t *closure) {
+    if (size <= 0) return 0;
+    _Pool &pool = _pool();
+    if (!pool.started) start_work_pool();
+    int workers = (int)pool.workers.size();
+    int slot = _pool_slot() < 0 ? workers : _pool_slot();
+
+    std::shared_ptr<_PoolJob> job(new _PoolJob);
+    job->user_context = user_context;
+    job->f = f;
+    job->closure = closure;
+    job->min = min;
+    job->shares = std::min(workers + 1, size);
+    job->chunk = std::max(1, size / (job->shares * pool.chunks_per_share));
+    job->ranges.reset(new std::atomic<uint64_t>[job->shares]);
+    for (int s = 0; s < job->shares; s++) {
+        uint64_t b = (uint64_t)size * s / job->shares, e = (uint64_t)size * (s + 1) / job->shares;
+        job->ranges[s] = (b << 32) | e;
+    }
+    job->pending = size;
+    job->result = 0;
+
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        pool.jobs.push_back(job);
+        pool.generation++;
+    }
+    pool.wake.notify_all();
+
+    _run_job(*job, slot);
+    {
+        std::unique_lock<std::mutex> guard(job->done_lock);
+        job->done.wait(guard, [&] { return job->pending == 0; });
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        pool.jobs.erase(std::find(pool.jobs.begin(), pool.jobs.end(), job));
+    }
+    return job->result;
+}
+
+// Per worker, and last for threads outside the pool (whose idle time
+// means nothing), since the last reset
+inline std::vector<WorkerStats> work_pool_stats() {
+    _Pool &pool = _pool();
+    std::vector<WorkerStats> stats;
+    if (!pool.started) return stats;
+    double elapsed = (_monotonic_ns() - pool.reset_ns) * 1e-9;
+    for (size_t i = 0; i <= pool.workers.size(); i++) {
+        WorkerStats s;
+        s.busy = pool.counters[i].busy_ns * 1e-9;
+        s.idle = elapsed > s.busy ? elapsed - s.busy : 0;
+        s.chunks = pool.counters[i].chunks;
+        s.steals = pool.counters[i].steals;
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+inline void reset_work_pool_stats() {
+    _Pool &pool = _pool();
+    if (!pool.started) return;
+    for (size_t i = 0; i <= pool.workers.size(); i++) {
+        pool.counters[i].busy_ns = pool.counters[i].chunks = pool.counters[i].steals = 0;
+    }
+    pool.reset_ns = _monotonic_ns();
+}
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef AUTOTUNE_PROGRESSIVE_H
+#define AUTOTUNE_PROGRESSIVE_H
+
+// Progressive-size evaluation: time a candidate on a ladder of sizes
+// that doubles up to the full one, and give up as soon as the time
+// extrapolated to full size can't compete with the incumbent. Most bad
+// schedules are already obviously bad at 256x256.
+
+#include <Halide.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "harness.h"
+
+namespace autotune {
+
+// The full size with its first two dimensions halved until the smaller
+// of them would drop below start, smallest first and ending with full
+// itself. Other dimensions (e.g. channels) are left alone.
+inline std::vector<std::vector<int> > size_ladder(const std::vector<int> &full, int start = 256) {
+    std::vector<std::vector<int> > ladder;
+    int spatial = full.size() < 2 ? (int)full.size() : 2;
+    int smallest = 0;
+    for (int i = 0; i < spatial; i++) {
+        if (i == 0 || full[i] < smallest) smallest = full[i];
+    }
+    for (int shift = 0; spatial && (smallest >> shift) >= start; shift++) {
+        std::vector<int> s = full;
+        for (int i = 0; i < spatial; i++) s[i] = (full[i] + (1 << shift) - 1) >> shift;
+        ladder.insert(ladder.begin(), s);
+    }
+    if (ladder.empty()) ladder.push_back(full);
+    return ladder;
+}
+
+inline double points(const std::vector<int> &size) {
+    double p = 1;
+    for (size_t i = 0; i < size.size(); i++) p *= size[i] ? size[i] : 1;
+    return p;
+}
+
+// Extrapolate measured (points, time) pairs to target points. Two models
+// are fitted: time proportional to points through the last measurement,
+// and a power law fitted by least squares in log space over all of them
+// (which catches schedules that scale worse than linearly). The smaller
+// prediction wins, so that a candidate is only dropped when it looks bad
+// under both.
+inline double extrapolate(const std::vector<double> &p, const std::vector<double> &t, double target) {
+    if (p.empty()) return 0;
+    double linear = t.back() * target / p.back();
+    if (p.size() < 2) return linear;
+
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n = p.size();
+    for (size_t i = 0; i < p.size(); i++) {
+        double x = log(p[i]), y = log(t[i] > 0 ? t[i] : 1e-9);
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    double denom = n * sxx - sx * sx;
+    if (denom <= 0) return linear;
+    double k = (n * sxy - sx * sy) / denom;
+    double c = (sy - k * sx) / n;
+    double power = exp(c + k * log(target));
+    return power < linear ? power : linear;
+}
+
+struct ProgressiveResult {
+    Result result;      // measurement at the last size that ran
+    bool pruned;        // stopped before reaching full size
+    double predicted;   // extrapolated full-size time when pruned, else the measured time
+    std::vector<std::vector<int> > sizes;  // sizes that ran
+};
+
+// Measure func on size_ladder(full). Before each larger size, the time
+// extrapolated to full size is compared with incumbent * slack; if it is
+// worse, evaluation stops and the extrapolation stands in for the
+// measurement. An incumbent of 0 means there is nothing to beat, so the
+// ladder always runs to full size. func must already be compiled.
+inline ProgressiveResult progressive_measure(Halide::Func &func, const std::vector<int> &full,
+                                             int trials, double incumbent, double slack = 1.5,
+                                             unsigned int limit = 0, int start = 256) {
+    std::vector<std::vector<int> > ladder = size_ladder(full, start);
+    std::vector<double> p, t;
+    ProgressiveResult r;
+    r.pruned = false;
+    for (size_t i = 0; i < ladder.size(); i++) {
+        Halide::Buffer output = autotune::bind(func, ladder[i]);
+        r.result = measure(func, output, trials, limit);
+        r.sizes.push_back(ladder[i]);
+        p.push_back(points(ladder[i]));
+        t.push_back(r.result.time);
+
+        bool last = i + 1 == ladder.size();
+        r.predicted = last ? r.result.time : extrapolate(p, t, points(full));
+        if (!last && incumbent > 0 && r.predicted > incumbent * slack) {
+            r.pruned = true;
+            break;
+        }
+    }
+    return r;
+}
+
+// Same format as print_result, with "time" being the extrapolated
+// full-size time for pruned candidates
+inline void print_progressive_result(const ProgressiveResult &r) {
+    std::string sizes;
+    for (size_t i = 0; i < r.sizes.size(); i++) {
+        if (i) sizes += ",";
+        for (size_t j = 0; j < r.sizes[i].size(); j++) {
+            char buf[16];
+            snprintf(buf, sizeof(buf), j ? "x%d" : "%d", r.sizes[i][j]);
+            sizes += buf;
+        }
+    }
+    printf("{\"time\": %.10f, \"pruned\": %d, \"measured\": %.10f, \"sizes\": \"%s\", "
+           "\"peak_mem\": %zu, \"allocs\": %zu, \"max_rss\": %zu}\n",
+           r.predicted, r.pruned ? 1 : 0, r.result.time, sizes.c_str(),
+           r.result.peak_mem, r.result.allocs, r.result.max_rss);
+    fflush(stdout);
+}
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef AUTOTUNE_SPECIALIZE_H
+#define AUTOTUNE_SPECIALIZE_H
+
+// Size-specialized code paths with dispatch at run time. A split whose
+// factor doesn't divide the extent leaves a tail that Halide handles by
+// shifting the last iteration back inside the extent. The shift shows
+// up in the lowered code as min(y*8 + min, min + extent - 8) on every
+// iteration, plus the bounds recomputed from it. When the output's
+// extents are declared multiples of m (as counts * m, with the counts
+// unknown until run time), splits by divisors of m need no tail at all.
+//
+// A Specialized holds two builds of the same pipeline with the same
+// schedule: the generic one, and one whose output is bound to multiples
+// of m. pick() chooses per output size, so sizes that aren't multiples
+// of m still work, just on the generic path. The bound is on the output
+// only: intermediates computed at root keep their own (halo-extended)
+// extents.
+
+#include <Halide.h>
+
+#include <string>
+#include <vector>
+
+namespace autotune {
+
+struct Specialized {
+    Halide::Func generic, special;
+    int multiple;
+    std::vector<Halide::Param<int> > counts;  // extent / multiple, per bound dimension
+
+    // Whether size can take the specialized path
+    bool matches(const std::vector<int> &size) const {
+        if (size.size() < counts.size()) return false;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (size[i] % multiple != 0) return false;
+        }
+        return true;
+    }
+
+    // The build to realize size with, with its parameters set
+    Halide::Func &pick(const std::vector<int> &size) {
+        if (!matches(size)) return generic;
+        for (size_t i = 0; i < counts.size(); i++) counts[i].set(size[i] / multiple);
+        return special;
+    }
+};
+
+// Bind the first dims dimensions of special's output to [0, n * multiple)
+// for run-time n. generic and special must be separate builds of the
+// same algorithm (special gets the bounds), scheduled alike.
+inline Specialized specialize(Halide::Func generic, Halide::Func special, int multiple, int dims = 2) {
+    Specialized s;
+    s.generic = generic;
+    s.special = special;
+    s.multiple = multiple;
+    std::vector<std::string> args = special.function().args();
+    for (int i = 0; i < dims && i < (int)args.size(); i++) {
+        Halide::Param<int> n("autotune_count_" + args[i]);
+        special.bound(Halide::Var(args[i]), 0, Halide::Expr(n) * multiple);
+        s.counts.push_back(n);
+    }
+    return s;
+}
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef AUTOTUNE_STATS_H
+#define AUTOTUNE_STATS_H
+
+// Summary statistics shared by the timing harness and the comparison
+// tools. Nothing in here depends on Halide.
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace autotune {
+
+inline double mean(const std::vector<double> &v) {
+    if (v.empty()) return 0;
+    double s = 0;
+    for (size_t i = 0; i < v.size(); i++) s += v[i];
+    return s / v.size();
+}
+
+// Sample standard deviation (n - 1 in the denominator)
+inline double stddev(const std::vector<double> &v) {
+    if (v.size() < 2) return 0;
+    double m = mean(v), s = 0;
+    for (size_t i = 0; i < v.size(); i++) s += (v[i] - m) * (v[i] - m);
+    return sqrt(s / (v.size() - 1));
+}
+
+// Linear interpolation between order statistics, p in [0, 1]
+inline double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    double pos = p * (v.size() - 1);
+    size_t lo = (size_t)pos;
+    if (lo + 1 >= v.size()) return v.back();
+    double frac = pos - lo;
+    return v[lo] * (1 - frac) + v[lo + 1] * frac;
+}
+
+inline double median(const std::vector<double> &v) {
+    return percentile(v, 0.5);
+}
+
+inline double minimum(const std::vector<double> &v) {
+    if (v.empty()) return 0;
+    return *std::min_element(v.begin(), v.end());
+}
+
+// Continued fraction for the regularized incomplete beta function
+// (Numerical Recipes, betacf).
+inline double _incomplete_beta_cf(double a, double b, double x) {
+    const double eps = 1e-12, tiny = 1e-300;
+    double qab = a + b, qap = a + 1, qam = a - 1;
+    double c = 1, d = 1 - qab * x / qap;
+    if (fabs(d) < tiny) d = tiny;
+    d = 1 / d;
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        int m2 = 2 * m;
+        double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+        d = 1 + aa * d;
+        if (fabs(d) < tiny) d = tiny;
+        c = 1 + aa / c;
+        if (fabs(c) < tiny) c = tiny;
+        d = 1 / d;
+        h *= d * c;
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+        d = 1 + aa * d;
+        if (fabs(d) < tiny) d = tiny;
+        c = 1 + aa / c;
+        if (fabs(c) < tiny) c = tiny;
+        d = 1 / d;
+        double del = d * c;
+        h *= del;
+        if (fabs(del - 1) < eps) break;
+    }
+    return h;
+}
+
+inline double incomplete_beta(double a, double b, double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    double bt = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) {
+        return bt * _incomplete_beta_cf(a, b, x) / a;
+    }
+    return 1 - bt * _incomplete_beta_cf(b, a, 1 - x) / b;
+}
+
+// Two-sided p-value of Student's t statistic with dof degrees of freedom
+inline double student_t_p_value(double t, double dof) {
+    if (dof <= 0) return 1;
+    return incomplete_beta(dof / 2, 0.5, dof / (dof + t * t));
+}
+
+// Critical value c with P(|T| > c) = alpha, found by bisection
+inline double student_t_critical(double alpha, double dof) {
+    double lo = 0, hi = 1000;
+    for (int i = 0; i < 100; i++) {
+        double mid = (lo + hi) / 2;
+        if (student_t_p_value(mid, dof) > alpha) lo = mid; else hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+// Ratio b/a estimated from paired samples (a[i], b[i]) taken back to
+// back, so drift common to both members of a pair cancels out. The test
+// is a paired t-test on log(b/a); ratio and interval are in linear space.
+struct RatioEstimate {
+    double ratio;      // geometric mean of b[i]/a[i]
+    double lo, hi;     // 95% confidence interval on ratio
+    double p_value;    // two-sided, null hypothesis ratio == 1
+    int n;
+};
+
+inline RatioEstimate paired_ratio(const std::vector<double> &a, const std::vector<double> &b) {
+    std::vector<double> d;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        if (a[i] > 0 && b[i] > 0) d.push_back(log(b[i] / a[i]));
+    }
+    RatioEstimate r;
+    r.n = (int)d.size();
+    double m = mean(d);
+    r.ratio = exp(m);
+    if (d.size() < 2) {
+        r.lo = 0;
+        r.hi = HUGE_VAL;
+        r.p_value = 1;
+        return r;
+    }
+    double se = stddev(d) / sqrt((double)d.size());
+    double dof = d.size() - 1;
+    if (se == 0) {
+        r.lo = r.hi = r.ratio;
+        r.p_value = (m == 0) ? 1 : 0;
+        return r;
+    }
+    double c = student_t_critical(0.05, dof);
+    r.lo = exp(m - c * se);
+    r.hi = exp(m + c * se);
+    r.p_value = student_t_p_value(m / se, dof);
+    return r;
+}
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef AUTOTUNE_STREAM_H
+#define AUTOTUNE_STREAM_H
+
+// Out-of-core realization over memory-mapped raw images. The output is
+// realized in strips of rows straight into a mapped output file, and
+// before each strip a bounds query finds the window of the mapped input
+// file it reads, which is prefetched and bound as the pipeline's input
+// without copying. Nothing is read until a strip touches it, so what
+// stays resident is what the strips touch: the input rows above the
+// window (which no later strip reads) and the finished output strip are
+// dropped from the process with madvise. The pipeline's own allocations
+// are sized by the strip, not the image.
+//
+// Halide indexes buffers in 32 bits, coordinate times stride summed over
+// the dimensions, so a window of an image of 2^31 elements or more can't
+// always be addressed in place (the third plane of a planar 32768^2
+// image starts at 2^31). Such windows are copied to or from a dense
+// buffer of their own, whose strides span the window instead of the
+// image; where even that overflows, streaming stops with an error.
+//
+// A raw image is the elements of a buffer_t layout (host NULL, min 0)
+// with nothing in front or between: e.g. planar float is strides
+// 1, w, w*h and interleaved RGBA float is 4, 4*w, 1.
+
+#include <Halide.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "harness.h"
+#include "inputs.h"
+#include "memory.h"
+
+namespace autotune {
+
+struct MappedFile {
+    uint8_t *data;
+    size_t bytes;
+};
+
+// A dense layout of the given extents (0 for missing dimensions) whose
+// dimensions are stored in the given order, innermost first. Returns
+// false if a stride doesn't fit in an int.
+inline bool raw_layout(Halide::Type t, const std::vector<int> &extents, const std::vector<int> &order, buffer_t &b) {
+    memset(&b, 0, sizeof(b));
+    b.elem_size = t.bytes();
+    int64_t stride = 1;
+    for (size_t i = 0; i < order.size(); i++) {
+        int d = order[i];
+        if (stride > INT_MAX) return false;
+        b.extent[d] = extents[d];
+        b.stride[d] = (int)stride;
+        stride *= extents[d] ? extents[d] : 1;
+    }
+    return true;
+}
+
+// Whether Halide's 32-bit index arithmetic reaches every element of b:
+// the largest coordinate times the stride, summed over the dimensions,
+// stays below 2^31
+inline bool addressable(const buffer_t &b) {
+    int64_t reach = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!b.extent[i]) continue;
+        int64_t lo = b.min[i], hi = (int64_t)b.min[i] + b.extent[i] - 1, s = b.stride[i];
+        reach += std::max(lo < 0 ? -lo : lo, hi < 0 ? -hi : hi) * (s < 0 ? -s : s);
+    }
+    return reach <= INT_MAX;
+}
+
+// The region of b densely packed, its dimensions stored in the same
+// order as b's, with no host. Strides past INT_MAX are cut to it, which
+// leaves the layout unaddressable anyway.
+inline buffer_t dense_like(const buffer_t &b) {
+    buffer_t d = b;
+    d.host = NULL;
+    d.dev = 0;
+    int order[4] = {0, 1, 2, 3};
+    std::sort(order, order + 4, [&](int i, int j) { return std::abs(b.stride[i]) < std::abs(b.stride[j]); });
+    int64_t stride = 1;
+    for (int i = 0; i < 4; i++) {
+        int k = order[i];
+        if (!b.extent[k]) continue;
+        d.stride[k] = (int)std::min(stride, (int64_t)INT_MAX);
+        stride *= b.extent[k];
+    }
+    return d;
+}
+
+// Copy the elements of from into to, which cover the same region
+inline void copy_region(const buffer_t &from, const buffer_t &to) {
+    int e[4];
+    for (int i = 0; i < 4; i++) e[i] = from.extent[i] ? from.extent[i] : 1;
+    size_t elem = from.elem_size, row = from.stride[0] == 1 && to.stride[0] == 1 ? e[0] : 1;
+    for (int k = 0; k < e[3]; k++) {
+        for (int j = 0; j < e[2]; j++) {
+            for (int i = 0; i < e[1]; i++) {
+                for (int x = 0; x < e[0]; x += row) {
+                    ptrdiff_t f = (ptrdiff_t)x * from.stride[0] + (ptrdiff_t)i * from.stride[1] +
+                                  (ptrdiff_t)j * from.stride[2] + (ptrdiff_t)k * from.stride[3];
+                    ptrdiff_t t = (ptrdiff_t)x * to.stride[0] + (ptrdiff_t)i * to.stride[1] +
+                                  (ptrdiff_t)j * to.stride[2] + (ptrdiff_t)k * to.stride[3];
+                    memcpy(to.host + t * elem, from.host + f * elem, row * elem);
+                }
+            }
+        }
+    }
+}
+
+inline size_t layout_bytes(const buffer_t &layout) {
+    size_t n = layout.elem_size;
+    for (int i = 0; i < 4; i++) n *= layout.extent[i] ? layout.extent[i] : 1;
+    return n;
+}
+
+// Map a file of the given size shared, so that writes go to the file.
+// writable creates (or truncates to size) the file first. Returns false,
+// with f.data NULL, if the file can't be opened or is too small.
+inline bool map_file(const std::string &path, size_t bytes, bool writable, MappedFile &f) {
+    f.data = NULL;
+    f.bytes = bytes;
+    int fd = writable ? open(path.c_str(), O_RDWR | O_CREAT, 0644) : open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = writable ? ftruncate(fd, bytes) == 0 : fstat(fd, &st) == 0 && (size_t)st.st_size >= bytes;
+    if (ok) {
+        void *p = mmap(NULL, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) f.data = (uint8_t *)p;
+    }
+    close(fd);
+    return f.data != NULL;
+}
+
+inline void unmap_file(MappedFile &f) {
+    if (f.data) munmap(f.data, f.bytes);
+    f.data = NULL;
+}
+
+// The region [min, min + extent) of a raw image whose elements start at
+// base, as a buffer_t pointing into it
+inline buffer_t window_of(const buffer_t &layout, uint8_t *base, const int *min, const int *extent) {
+    buffer_t b = layout;
+    size_t offset = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!layout.extent[i]) continue;
+        b.min[i] = min[i];
+        b.extent[i] = extent[i];
+        offset += (size_t)(min[i] - layout.min[i]) * layout.stride[i];
+    }
+    b.host = base + offset * layout.elem_size;
+    return b;
+}
+
+// madvise the pages holding the window [min, min + extent) of a raw image
+// mapped at base, whose rows are dimension y. The rows of each plane (y
+// and everything stored inside it) are one range; dimensions stored
+// outside y split it into one range per plane. whole_pages shrinks each
+// range to the pages it covers completely, for advice that mustn't spill
+// onto neighbouring rows.
+inline void advise_window(const buffer_t &layout, uint8_t *base, const int *min, const int *extent,
+                          int advice, bool whole_pages, int y = 1) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t lo = 0, hi = 0;
+    std::vector<int> outer;
+    for (int i = 0; i < 4; i++) {
+        if (!layout.extent[i]) continue;
+        if (extent[i] <= 0) return;
+        if (i != y && layout.stride[i] > layout.stride[y]) {
+            outer.push_back(i);
+            continue;
+        }
+        lo += (size_t)(min[i] - layout.min[i]) * layout.stride[i];
+        hi += (size_t)(min[i] + extent[i] - 1 - layout.min[i]) * layout.stride[i];
+    }
+    size_t planes = 1;
+    for (size_t j = 0; j < outer.size(); j++) planes *= extent[outer[j]];
+    for (size_t p = 0; p < planes; p++) {
+        size_t offset = 0, q = p;
+        for (size_t j = 0; j < outer.size(); j++) {
+            int d = outer[j];
+            offset += (size_t)(min[d] + q % extent[d] - layout.min[d]) * layout.stride[d];
+            q /= extent[d];
+        }
+        uintptr_t from = (uintptr_t)(base + (offset + lo) * layout.elem_size);
+        uintptr_t to = (uintptr_t)(base + (offset + hi + 1) * layout.elem_size);
+        from = whole_pages ? (from + page - 1) / page * page : from / page * page;
+        to = whole_pages ? to / page * page : (to + page - 1) / page * page;
+        if (to > from) madvise((void *)from, to - from, advice);
+    }
+}
+
+// The region of input that realizing func over out's region reads, by a
+// bounds query: input is bound to a buffer_t with no host and the
+// layout's extents (which clamps in the pipeline see as the image's
+// size), and realizing into out then fills in the required min and
+// extent instead of running. input is left bound to the query.
+inline buffer_t input_window(Halide::Func &func, Halide::Internal::Parameter input, const buffer_t &layout,
+                             Halide::Buffer out) {
+    buffer_t query = layout;
+    query.host = NULL;
+    query.dev = 0;
+    Halide::Buffer q(input.type(), &query);
+    input.set_buffer(q);
+    func.realize(out);
+    return *q.raw_buffer();
+}
+
+struct StreamStats {
+    double time;            // every strip, including queries and madvise
+    int strips;
+    size_t peak_mem;        // largest high-water mark of the pipeline's allocations in one strip
+    size_t input_rows;      // input rows read, summed over strips
+    size_t max_rss;         // peak resident set of the whole process
+    size_t copied;          // bytes of windows that couldn't be addressed in place, copied in or out
+    std::string error;      // why streaming stopped early, empty if it didn't
+};
+
+// The window b of a raw image as a buffer Halide can address: b itself,
+// or a dense copy of its region in staging (copied in if copy_in), or
+// false if neither is addressable
+inline bool _addressable_window(const buffer_t &b, bool copy_in, std::vector<uint8_t> &staging, buffer_t &got) {
+    if (addressable(b)) {
+        got = b;
+        return true;
+    }
+    got = dense_like(b);
+    if (!addressable(got)) return false;
+    staging.resize(layout_bytes(got));
+    got.host = staging.data();
+    if (copy_in) copy_region(b, got);
+    return true;
+}
+
+// Realize func's output, a raw image of out_layout, into out in strips of
+// rows (dimension 1) from in, a raw image of in_layout of which each
+// strip binds the window it reads as func's only input; in's rows are
+// dimension in_y (2 for channels innermost). func must already be
+// compiled, and must clamp to its input's min and extent rather than to
+// 0 and extent, since the window starts where the strip's reads do. Stops
+// with s.error set at the first window Halide can't address even copied.
+inline StreamStats stream_strips(Halide::Func &func, const MappedFile &in, const buffer_t &in_layout,
+                                 const MappedFile &out, const buffer_t &out_layout, int rows, int in_y = 1) {
+    StreamStats s;
+    s.strips = 0;
+    s.peak_mem = 0;
+    s.input_rows = 0;
+    s.copied = 0;
+    std::vector<Halide::Internal::Parameter> params = find_input_params(func);
+    Halide::Internal::Parameter input = params[0];
+    Halide::Type out_type = func.output_types()[0];
+    std::vector<uint8_t> in_staging, out_staging;
+
+    int released = in_layout.min[in_y], end = out_layout.min[1] + out_layout.extent[1];
+    double t1 = now();
+    for (int y = out_layout.min[1]; y < end; y += rows) {
+        int min[4], extent[4];
+        for (int i = 0; i < 4; i++) {
+            min[i] = out_layout.min[i];
+            extent[i] = out_layout.extent[i];
+        }
+        min[1] = y;
+        extent[1] = end - y < rows ? end - y : rows;
+        buffer_t strip = window_of(out_layout, out.data, min, extent), target;
+        if (!_addressable_window(strip, false, out_staging, target)) {
+            s.error = "output rows " + std::to_string(y) + " on are out of reach of Halide's 32-bit indexing";
+            break;
+        }
+        Halide::Buffer strip_out(out_type, &target);
+
+        buffer_t w = input_window(func, input, in_layout, strip_out);
+        advise_window(in_layout, in.data, w.min, w.extent, MADV_WILLNEED, false, in_y);
+        if (w.min[in_y] > released) {
+            int done_min[4], done_extent[4];
+            for (int i = 0; i < 4; i++) {
+                done_min[i] = in_layout.min[i];
+                done_extent[i] = in_layout.extent[i];
+            }
+            done_min[in_y] = released;
+            done_extent[in_y] = w.min[in_y] - released;
+            advise_window(in_layout, in.data, done_min, done_extent, MADV_DONTNEED, true, in_y);
+            released = w.min[in_y];
+        }
+        s.input_rows += w.extent[in_y];
+
+        buffer_t window = window_of(in_layout, in.data, w.min, w.extent), source;
+        if (!_addressable_window(window, true, in_staging, source)) {
+            s.error = "input rows " + std::to_string(w.min[in_y]) + " on are out of reach of Halide's 32-bit indexing";
+            break;
+        }
+        if (source.host != window.host) s.copied += layout_bytes(source);
+        input.set_buffer(Halide::Buffer(input.type(), &source));
+        reset_alloc_stats();
+        func.realize(strip_out);
+        if (alloc_stats().peak > s.peak_mem) s.peak_mem = alloc_stats().peak;
+        if (target.host != strip.host) {
+            copy_region(target, strip);
+            s.copied += layout_bytes(target);
+        }
+        // Written pages of a shared mapping stay in the page cache for
+        // writeback; this only unmaps them from the process.
+        advise_window(out_layout, out.data, min, extent, MADV_DONTNEED, true);
+        s.strips++;
+    }
+    s.time = now() - t1;
+    s.max_rss = max_rss_bytes();
+    return s;
+}
+
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef AUTOTUNE_TILED_H
+#define AUTOTUNE_TILED_H
+
+// Realizing an output in tiles to bound the memory a pipeline holds, the
+// way the test cases' GPU schedule does for GPUs that can't hold the
+// whole image. Each tile is one realize into a crop of the output, so
+// intermediates computed at root are only as big as a tile plus its
+// halo; the price is the halo, recomputed by every tile that needs it.
+//
+// Tiles run one after another, or in parallel on several builds of the
+// same pipeline (one per worker: a Func can't be realized from two
+// threads at once). The budget is for the pipeline's own allocations,
+// all workers together; the output and inputs are outside it.
+
+#include <Halide.h>
+#include <math.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "inputs.h"
+#include "memory.h"
+#include "stream.h"
+
+namespace autotune {
+
+// The tile at (x, y) of size w x h of output, clipped to it, as a buffer
+// pointing into output's memory. Dimensions past the second are whole.
+inline buffer_t tile_of(Halide::Buffer output, int x, int y, int w, int h) {
+    const buffer_t *o = output.raw_buffer();
+    int min[4], extent[4];
+    for (int i = 0; i < 4; i++) {
+        min[i] = o->min[i];
+        extent[i] = o->extent[i];
+    }
+    min[0] = x;
+    min[1] = y;
+    extent[0] = o->min[0] + o->extent[0] - x < w ? o->min[0] + o->extent[0] - x : w;
+    extent[1] = o->min[1] + o->extent[1] - y < h ? o->min[1] + o->extent[1] - y : h;
+    return window_of(*o, o->host, min, extent);
+}
+
+// The pipeline's allocation high-water mark for one tile of w x h at the
+// output's corner
+inline size_t tile_peak(Halide::Func &func, Halide::Buffer output, int w, int h) {
+    buffer_t t = tile_of(output, output.raw_buffer()->min[0], output.raw_buffer()->min[1], w, h);
+    reset_alloc_stats();
+    func.realize(Halide::Buffer(func.output_types()[0], &t));
+    return alloc_stats().peak;
+}
+
+// The largest tiles (multiples of 8 on a side, square where the output
+// allows) whose realization stays within budget bytes, by measuring: a
+// probe tile gives bytes per output point, which sizes a first guess,
+// and the guess shrinks until it fits. Returns false if even 8x8 tiles
+// don't fit.
+inline bool fit_tile(Halide::Func &func, Halide::Buffer output, size_t budget, int &w, int &h) {
+    int width = output.raw_buffer()->extent[0], height = output.raw_buffer()->extent[1];
+    w = width < 256 ? width : 256;
+    h = height < 256 ? height : 256;
+    double per_point = (double)tile_peak(func, output, w, h) / ((double)w * h);
+    double points = per_point > 0 ? budget / per_point : (double)width * height;
+    double side = sqrt(points);
+    w = side < width ? (int)side : width;
+    h = side < width ? w : points / width < height ? (int)(points / width) : height;
+    w = w < width ? w / 8 * 8 : width;
+    h = h < height ? h / 8 * 8 : height;
+    if (w < 8) w = 8;
+    if (h < 8) h = 8;
+    while (tile_peak(func, output, w, h) > budget) {
+        if (w <= 8 && h <= 8) return false;
+        if (w >= h) w = w / 16 * 8 > 8 ? w / 16 * 8 : 8;
+        else h = h / 16 * 8 > 8 ? h / 16 * 8 : 8;
+    }
+    return true;
+}
+
+// Input points the tiles read, summed, per input point that realizing the
+// whole output at once reads: 1 means no halo. Uses bounds queries on
+// func, whose input bindings are restored afterwards.
+inline double halo_overhead(Halide::Func &func, Halide::Buffer output, int w, int h) {
+    std::vector<Halide::Internal::Parameter> params = find_input_params(func);
+    std::vector<Halide::Buffer> bound;
+    for (size_t i = 0; i < params.size(); i++) bound.push_back(params[i].get_buffer());
+    const buffer_t *o = output.raw_buffer();
+
+    double tiled = 0, whole = 0;
+    for (size_t i = 0; i < params.size(); i++) {
+        buffer_t all = input_window(func, params[i], *bound[i].raw_buffer(), output);
+        whole += layout_bytes(all);
+        for (int y = o->min[1]; y < o->min[1] + o->extent[1]; y += h) {
+            for (int x = o->min[0]; x < o->min[0] + o->extent[0]; x += w) {
+                buffer_t t = tile_of(output, x, y, w, h);
+                buffer_t r = input_window(func, params[i], *bound[i].raw_buffer(), Halide::Buffer(output.type(), &t));
+                tiled += layout_bytes(r);
+            }
+        }
+        params[i].set_buffer(bound[i]);
+    }
+    return whole > 0 ? tiled / whole : 1;
+}
+
+struct TiledStats {
+    double time;
+    int tiles;
+    size_t peak_mem;  // high-water mark of all workers' allocations together
+};
+
+// Realize output in tiles of w x h, spread over funcs: one build of the
+// pipeline per worker, each compiled and with its inputs bound.
+inline TiledStats realize_tiled(std::vector<Halide::Func> &funcs, Halide::Buffer output, int w, int h) {
+    const buffer_t *o = output.raw_buffer();
+    int across = (o->extent[0] + w - 1) / w, down = (o->extent[1] + h - 1) / h;
+    TiledStats s;
+    s.tiles = across * down;
+
+    std::atomic<int> next(0);
+    auto work = [&](size_t worker) {
+        for (int i = next++; i < s.tiles; i = next++) {
+            buffer_t t = tile_of(output, o->min[0] + i % across * w, o->min[1] + i / across * h, w, h);
+            funcs[worker].realize(Halide::Buffer(output.type(), &t));
+        }
+    };
+    reset_alloc_stats();
+    double t1 = now();
+    if (funcs.size() == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < funcs.size(); i++) threads.push_back(std::thread(work, i));
+        for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    }
+    s.time = now() - t1;
+    s.peak_mem = alloc_stats().peak;
+    return s;
+}
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef AUTOTUNE_TRACE_H
+#define AUTOTUNE_TRACE_H
+
+// A timeline of a pipeline's realizations, cheap enough to record at
+// production sizes, instead of HL_TRACE's text dump through the
+// runtime's default handler, which prints every event as it happens.
+//
+// enable_tracing(func, store_every) turns on Halide's tracing for the
+// whole pipeline when it is next compiled (HL_TRACE=1 for realizations
+// and produce/consume, 2 to add stores) and installs trace_event as its
+// handler. The handler keeps realizations and produce, update and
+// consume events, one in store_every stores, and nothing else. Each
+// thread appends to its own ring buffer of fixed size, so recording
+// takes no lock and no allocation, and when a ring is full the oldest
+// events are overwritten. write_trace() writes what the rings hold as
+// Chrome trace event JSON (chrome://tracing or ui.perfetto.dev): one
+// timeline row per thread, realizations and their produce, update and
+// consume phases as nested spans, sampled stores as instants with their
+// first two coordinates.
+
+#include <Halide.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace autotune {
+
+struct TraceEvent {
+    uint64_t time;     // ns, CLOCK_MONOTONIC
+    const char *func;  // owned by the compiled pipeline
+    int32_t event;     // halide_trace_event_code
+    int32_t x, y;  // first two coordinates of stores
+};
+
+struct _TraceRing {
+    int thread;
+    std::vector<TraceEvent> events;  // a power of two of them
+    std::atomic<uint64_t> head;      // events ever recorded, only written by the owning thread
+    uint64_t stores;                 // stores seen, sampled or not
+    _TraceRing(int thread, size_t size) : thread(thread), events(size), head(0), stores(0) {}
+};
+
+struct _Tracer {
+    std::mutex lock;  // only taken the first time a thread records
+    std::vector<std::unique_ptr<_TraceRing> > rings;
+    std::atomic<int32_t> next_id;
+    int store_every;
+    size_t ring_size;
+    uint64_t generation;  // bumped by reset_trace, so threads register anew
+    _Tracer() : next_id(1), store_every(0), ring_size(1 << 16), generation(0) {}
+};
+
+inline _Tracer &_tracer() {
+    static _Tracer tracer;
+    return tracer;
+}
+
+inline uint64_t _trace_clock() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+inline _TraceRing &_trace_ring() {
+    static thread_local _TraceRing *ring = NULL;
+    static thread_local uint64_t generation = 0;
+    _Tracer &tracer = _tracer();
+    if (!ring || generation != tracer.generation) {
+        std::lock_guard<std::mutex> guard(tracer.lock);
+        tracer.rings.emplace_back(new _TraceRing((int)tracer.rings.size(), tracer.ring_size));
+        ring = tracer.rings.back().get();
+        generation = tracer.generation;
+    }
+    return *ring;
+}
+
+// The trace handler. Returns the ids the pipeline passes back as
+// parent_id of the events inside a realization or produce.
+inline int trace_event(void *, const halide_trace_event *e) {
+    _Tracer &tracer = _tracer();
+    if (e->event == halide_trace_load) return 0;
+    _TraceRing &ring = _trace_ring();
+    int32_t id = 0;
+    if (e->event == halide_trace_store) {
+        if (tracer.store_every <= 0 || ++ring.stores % tracer.store_every) return 0;
+    } else {
+        id = tracer.next_id++;
+    }
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    TraceEvent &t = ring.events[head & (ring.events.size() - 1)];
+    t.time = _trace_clock();
+    t.func = e->func;
+    t.event = e->event;
+    t.x = e->event == halide_trace_store && e->dimensions > 0 ? e->coordinates[0] : 0;
+    t.y = e->event == halide_trace_store && e->dimensions > 1 ? e->coordinates[1] : 0;
+    ring.head.store(head + 1, std::memory_order_release);
+    return id;
+}
+
+// Record one in store_every stores (0 for none) in rings of ring_size
+// events per thread (rounded up to a power of two) from func's next
+// compilation on. Call before compile(), which reads HL_TRACE.
+inline void enable_tracing(Halide::Func &func, int store_every = 0, size_t ring_size = 1 << 16) {
+    _Tracer &tracer = _tracer();
+    tracer.store_every = store_every;
+    size_t size = 1;
+    while (size < ring_size) size *= 2;
+    tracer.ring_size = size;
+    setenv("HL_TRACE", store_every > 0 ? "2" : "1", 1);
+    func.set_custom_trace(trace_event);
+}
+
+// Drop everything recorded so far. No pipeline may be running.
+inline void reset_trace() {
+    _Tracer &tracer = _tracer();
+    std::lock_guard<std::mutex> guard(tracer.lock);
+    tracer.rings.clear();
+    tracer.generation++;
+}
+
+inline void _write_trace_event(FILE *f, bool &first, const char *name, const char *phase, uint64_t time, int thread) {
+    fprintf(f, "%s\n{\"name\": \"%s\", \"ph\": \"%s\", \"ts\": %.3f, \"pid\": 0, \"tid\": %d}", first ? "" : ",", name,
+            phase, time * 1e-3, thread);
+    first = false;
+}
+
+// Write the recorded timeline to path, and return the number of events
+// written, or -1 if the file can't be written. Rings that wrapped have
+// lost their oldest events, so the timeline starts at the latest of
+// their oldest events, where every thread's record is complete. No
+// pipeline may be running.
+inline long write_trace(const char *path) {
+    _Tracer &tracer = _tracer();
+    std::lock_guard<std::mutex> guard(tracer.lock);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    uint64_t start = 0, origin = UINT64_MAX;
+    for (size_t r = 0; r < tracer.rings.size(); r++) {
+        _TraceRing &ring = *tracer.rings[r];
+        uint64_t head = ring.head.load(std::memory_order_acquire), size = ring.events.size();
+        if (head == 0) continue;
+        uint64_t oldest = ring.events[head > size ? head & (size - 1) : 0].time;
+        if (head > size) start = std::max(start, oldest);
+        origin = std::min(origin, oldest);
+    }
+    origin = std::max(origin == UINT64_MAX ? 0 : origin, start);
+
+    long written = 0;
+    bool first = true;
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (size_t r = 0; r < tracer.rings.size(); r++) {
+        _TraceRing &ring = *tracer.rings[r];
+        uint64_t head = ring.head.load(std::memory_order_acquire), size = ring.events.size();
+        for (uint64_t i = head > size ? head - size : 0; i < head; i++) {
+            const TraceEvent &e = ring.events[i & (size - 1)];
+            if (e.time < start) continue;
+            uint64_t t = e.time - origin;
+            std::string name = e.func;
+            switch (e.event) {
+            case halide_trace_store:
+                fprintf(f, "%s\n{\"name\": \"store %s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 0, "
+                           "\"tid\": %d, \"args\": {\"x\": %d, \"y\": %d}}",
+                        first ? "" : ",", e.func, t * 1e-3, ring.thread, e.x, e.y);
+                first = false;
+                break;
+            case halide_trace_begin_realization:
+                _write_trace_event(f, first, e.func, "B", t, ring.thread);
+                break;
+            case halide_trace_end_realization:
+                _write_trace_event(f, first, e.func, "E", t, ring.thread);
+                break;
+            case halide_trace_produce:
+                _write_trace_event(f, first, ("produce " + name).c_str(), "B", t, ring.thread);
+                break;
+            case halide_trace_update:
+                // Ends the produce (or the previous update)
+                _write_trace_event(f, first, ("produce " + name).c_str(), "E", t, ring.thread);
+                _write_trace_event(f, first, ("update " + name).c_str(), "B", t, ring.thread);
+                break;
+            case halide_trace_consume:
+                _write_trace_event(f, first, ("produce " + name).c_str(), "E", t, ring.thread);
+                _write_trace_event(f, first, ("consume " + name).c_str(), "B", t, ring.thread);
+                break;
+            case halide_trace_end_consume:
+                _write_trace_event(f, first, ("consume " + name).c_str(), "E", t, ring.thread);
+                break;
+            }
+            written++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return written;
+}
+
+// Events recorded and events lost to full rings, over all threads
+inline void trace_counts(size_t &recorded, size_t &dropped) {
+    _Tracer &tracer = _tracer();
+    std::lock_guard<std::mutex> guard(tracer.lock);
+    recorded = dropped = 0;
+    for (size_t r = 0; r < tracer.rings.size(); r++) {
+        uint64_t head = tracer.rings[r]->head.load(std::memory_order_acquire), size = tracer.rings[r]->events.size();
+        recorded += head;
+        if (head > size) dropped += head - size;
+    }
+}
+
+}
+
+#endif
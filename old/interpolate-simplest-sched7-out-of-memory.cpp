@@ -1,11 +1,3 @@
-#include <Halide.h>
-#include <stdio.h>
-#include <sys/time.h>
-#include <unistd.h>
-
-#include <map>
-#include <string>
-
 // How many times to run (and take min)
 // #define AUTOTUNE_TRIALS 3
 
@@ -15,34 +7,12 @@
 // Size to run with
 // #define AUTOTUNE_N 1024, 1024
 
-inline void _autotune_timing_stub(Halide::Func& func) {
-    func.compile_jit();
-    func.infer_input_bounds(AUTOTUNE_N);
-    timeval t1, t2;
-    double rv = 0;
-    const unsigned int timeout = AUTOTUNE_LIMIT;
-    alarm(timeout);
-    for (int i = 0; i < AUTOTUNE_TRIALS; i++) {
-      gettimeofday(&t1, NULL);
-      func.realize(AUTOTUNE_N);
-      gettimeofday(&t2, NULL);
-      alarm(0); // disable alarm
-      double t = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec)/1000000.0;
-      if(i == 0 || t < rv)
-        rv = t;
-    }
-    printf("{\"time\": %.10f}\n", rv);
-    exit(0);
-}
-
-
-#ifndef AUTOTUNE_HOOK
-#define AUTOTUNE_HOOK(x)
+// Set up the output and inputs as this file's own stub did
+#ifndef AUTOTUNE_FILL
+#define AUTOTUNE_FILL 0
 #endif
 
-#ifndef BASELINE_HOOK
-#define BASELINE_HOOK(x)
-#endif
+#include "timing_prefix.h"
 
 #include "Halide.h"
 
@@ -1,26 +1,15 @@
-#include <Halide.h>
-#include <stdio.h>
-#include <sys/time.h>
-
+// Size and trials to run with - override Makefile setting
+#undef AUTOTUNE_N
 #define AUTOTUNE_N 1024,1024
+#undef AUTOTUNE_TRIALS
 #define AUTOTUNE_TRIALS 3
 
-inline void _autotune_timing_stub(Halide::Func& func) {
-    func.compile_jit();
-    func.infer_input_bounds(AUTOTUNE_N);
-    timeval t1, t2;
-    double rv = 0;
-    for (int i = 0; i < AUTOTUNE_TRIALS; i++) {
-      gettimeofday(&t1, NULL);
-      func.realize(AUTOTUNE_N);
-      gettimeofday(&t2, NULL);
-      double t = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec)/1000000.0;
-      if(i == 0 || t < rv)
-        rv = t;
-    }
-    printf("{\"time\": %.10f}\n", rv);
-    exit(0);
-}
+// Set up the output and inputs as this file's own stub did
+#ifndef AUTOTUNE_FILL
+#define AUTOTUNE_FILL 0
+#endif
+
+#include "timing_prefix.h"
 
 #include "Halide.h"
 #include <stdio.h>
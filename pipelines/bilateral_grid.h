@@ -0,0 +1,130 @@
+#ifndef PIPELINES_BILATERAL_GRID_H
+#define PIPELINES_BILATERAL_GRID_H
+
+// The bilateral grid from old/error1.cpp and its siblings.
+//
+// The histogram there is one reduction over each grid cell's
+// s_sigma x s_sigma block of input, scattering into the bin zi of every
+// sample. Its update step has no pure loop a schedule can parallelize,
+// so unless it is computed inside a parallel loop of grid it runs on one
+// core. The tiled variant splits it in two:
+//
+//   histogram_rows(x, yy, z, c)  one private histogram per input row yy
+//                                and grid column x: the scatter, over
+//                                s_sigma samples
+//   histogram(x, y, z, c)        the sum of the s_sigma row histograms
+//                                of each cell: pure, no scatter
+//
+// No two rows share a histogram, so computing histogram_rows at a tile
+// of histogram's y and running histogram's y tiles in parallel has no
+// write races.
+//
+// The padded variant reads the input unclamped, from a buffer padded by
+// edge replication (see interpolate.h).
+
+#include <Halide.h>
+
+#include <string>
+
+#include "pipeline.h"
+
+namespace pipelines {
+
+struct BilateralGrid : public Pipeline {
+    Halide::ImageParam input;
+    int s_sigma;
+    float r_sigma;
+    Halide::Var x, y, z, c;
+    Halide::Func clamped, histogram, grid, blurx, blury, blurz, interpolated, bilateral_grid;
+    Halide::Func histogram_rows;  // tiled variant only
+    bool padded;
+};
+
+inline BilateralGrid make_bilateral_grid(int s_sigma = 4, float r_sigma = 0.1f, bool tiled = false,
+                                         bool padded = false) {
+    using namespace Halide;
+
+    BilateralGrid p;
+    NameCounter names;
+    p.name = std::string("bilateral_grid") + (tiled ? "_tiled" : "") + (padded ? "_padded" : "");
+    p.padded = padded;
+    p.s_sigma = s_sigma;
+    p.r_sigma = r_sigma;
+    p.input = ImageParam(Float(32), 2, "input");
+    Var x("x"), y("y"), z("z"), c("c");
+    p.x = x;
+    p.y = y;
+    p.z = z;
+    p.c = c;
+    ImageParam input = p.input;
+
+    // Add a boundary condition
+    Func clamped = p.clamped = make_func(p, names, "clamped");
+    if (padded) {
+        clamped(x, y) = input(x, y);
+    } else {
+        clamped(x, y) = input(clamp(x, 0, input.width()-1),
+                              clamp(y, 0, input.height()-1));
+    }
+
+    // Construct the bilateral grid
+    Func histogram = p.histogram = make_func(p, names, "histogram");
+    Func grid = p.grid = make_func(p, names, "grid");
+    Expr val, zi;
+    if (tiled) {
+        Var yy("yy");
+        RDom rx(0, s_sigma), ry(0, s_sigma);
+        val = clamp(clamped(x * s_sigma + rx - s_sigma/2, yy), 0.0f, 1.0f);
+        zi = cast<int>(val * (1.0f/r_sigma) + 0.5f);
+        Func rows = p.histogram_rows = make_func(p, names, "histogram_rows");
+        rows(x, yy, zi, c) += select(c == 0, val, 1.0f);
+        histogram(x, y, z, c) = sum(rows(x, y * s_sigma + ry - s_sigma/2, z, c));
+    } else {
+        RDom r(0, s_sigma, 0, s_sigma);
+        val = clamped(x * s_sigma + r.x - s_sigma/2, y * s_sigma + r.y - s_sigma/2);
+        val = clamp(val, 0.0f, 1.0f);
+        zi = cast<int>(val * (1.0f/r_sigma) + 0.5f);
+        histogram(x, y, zi, c) += select(c == 0, val, 1.0f);
+    }
+
+    // Introduce a dummy function, so we can schedule the histogram within it
+    grid(x, y, z, c) = histogram(x, y, z, c);
+
+    // Blur the grid using a five-tap filter
+    Func blurx = p.blurx = make_func(p, names, "blurx");
+    Func blury = p.blury = make_func(p, names, "blury");
+    Func blurz = p.blurz = make_func(p, names, "blurz");
+    blurx(x, y, z) = grid(x-2, y, z) + grid(x-1, y, z)*4 + grid(x, y, z)*6 + grid(x+1, y, z)*4 + grid(x+2, y, z);
+    blury(x, y, z) = blurx(x, y-2, z) + blurx(x, y-1, z)*4 + blurx(x, y, z)*6 + blurx(x, y+1, z)*4 + blurx(x, y+2, z);
+    blurz(x, y, z) = blury(x, y, z-2) + blury(x, y, z-1)*4 + blury(x, y, z)*6 + blury(x, y, z+1)*4 + blury(x, y, z+2);
+
+    // Take trilinear samples to compute the output
+    val = clamp(clamped(x, y), 0.0f, 1.0f);
+    Expr zv = val * (1.0f/r_sigma);
+    zi = cast<int>(zv);
+    Expr zf = zv - zi;
+    Expr xf = cast<float>(x % s_sigma) / s_sigma;
+    Expr yf = cast<float>(y % s_sigma) / s_sigma;
+    Expr xi = x/s_sigma;
+    Expr yi = y/s_sigma;
+    Func interpolated = p.interpolated = make_func(p, names, "interpolated");
+    interpolated(x, y) =
+        lerp(lerp(lerp(blurz(xi, yi, zi), blurz(xi+1, yi, zi), xf),
+                  lerp(blurz(xi, yi+1, zi), blurz(xi+1, yi+1, zi), xf), yf),
+             lerp(lerp(blurz(xi, yi, zi+1), blurz(xi+1, yi, zi+1), xf),
+                  lerp(blurz(xi, yi+1, zi+1), blurz(xi+1, yi+1, zi+1), xf), yf), zf);
+
+    // Normalize
+    Func bilateral_grid = p.bilateral_grid = make_func(p, names, "bilateral_grid");
+    bilateral_grid(x, y) = interpolated(x, y, 0)/interpolated(x, y, 1);
+
+    p.output = bilateral_grid;
+    p.dim_limit["c"] = 2;
+    p.size.push_back(2048);
+    p.size.push_back(2048);
+    return p;
+}
+
+}
+
+#endif
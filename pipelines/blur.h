@@ -0,0 +1,83 @@
+#ifndef PIPELINES_BLUR_H
+#define PIPELINES_BLUR_H
+
+// The 3x3 box blur on uint16 from old/halideerror*.cpp.
+//
+// The test cases add three uint16 values in uint16, which wraps for
+// inputs averaging above 21845, and divide the sum by 3 with a vector
+// integer division. The fixed-point variant accumulates in uint32 and
+// divides with a multiply and a shift (div3), giving the exact
+// floor((a + b + c) / 3) at every stage.
+//
+// The padded variant reads the input unclamped, from a buffer padded by
+// edge replication (see interpolate.h). With the test cases' boundary
+// condition the image proper is columns 1 to w-1 and rows 0 to h-1 of
+// in_img, shifted down by one row.
+
+#include <Halide.h>
+
+#include <string>
+
+#include "pipeline.h"
+
+namespace pipelines {
+
+// floor(sum / 3) for any sum of three uint16 values (sum < 3 * 2^16),
+// as uint16: sum * ceil(2^19 / 3) >> 19. The multiplier overshoots 2^19/3
+// by 1/3, an error of at most 196605 / 3 / 2^19 < 1/8 in the quotient,
+// which is less than the 1/3 that separates floor(sum / 3) from the next
+// integer. The product needs 36 bits.
+inline Halide::Expr div3(Halide::Expr sum) {
+    using namespace Halide;
+    return cast<uint16_t>((cast<uint64_t>(sum) * 174763) >> 19);
+}
+
+struct Blur : public Pipeline {
+    Halide::ImageParam in_img;
+    Halide::Var x, y;
+    Halide::Func input, blur_x, blur_y;
+    bool padded;
+};
+
+inline Blur make_blur(bool fixed_point = false, bool padded = false) {
+    using namespace Halide;
+
+    Blur p;
+    NameCounter names;
+    p.name = std::string("blur") + (fixed_point ? "_fixed" : "") + (padded ? "_padded" : "");
+    p.padded = padded;
+    p.in_img = ImageParam(UInt(16), 2, "in_img");
+    Var x("x"), y("y");
+    p.x = x;
+    p.y = y;
+    ImageParam in_img = p.in_img;
+
+    // Same (off by one) boundary condition as the test cases
+    Func input = p.input = make_func(p, names, "input");
+    if (padded) {
+        input(x,y) = in_img(x, y-1);
+    } else {
+        input(x,y) = in_img(clamp(x, 1, in_img.width()-1),
+                            clamp(y, 1, in_img.height())-1);
+    }
+
+    // The algorithm
+    Func blur_x = p.blur_x = make_func(p, names, "blur_x");
+    Func blur_y = p.blur_y = make_func(p, names, "blur_y");
+    if (fixed_point) {
+        blur_x(x, y) = div3(cast<uint32_t>(input(x, y)) + input(x+1, y) + input(x+2, y));
+        blur_y(x, y) = div3(cast<uint32_t>(blur_x(x, y)) + blur_x(x, y+1) + blur_x(x, y+2));
+    } else {
+        blur_x(x, y) = (input(x, y) + input(x+1, y) + input(x+2, y))/3;
+        blur_y(x, y) = (blur_x(x, y) + blur_x(x, y+1) + blur_x(x, y+2))/3;
+    }
+
+    p.output = blur_y;
+    p.size.push_back(1024);
+    p.size.push_back(1024);
+    return p;
+}
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef PIPELINES_INTERPOLATE_H
+#define PIPELINES_INTERPOLATE_H
+
+// The interpolate pyramid from interpolate-*.cpp, for any number of
+// levels. Funcs are created in the same order as in the test cases, so
+// their schedule names match the generated schedules for the same depth.
+//
+// The test cases read a planar input(x, y, c). The interleaved variant
+// reads RGBA frames as they arrive from capture, input(c, x, y) with the
+// channel innermost and pixels 4 floats apart, so the frame needs no
+// transpose to planar first. Everything downstream is the same algorithm
+// over the same (x, y, c) Funcs; a schedule that stores intermediates
+// channel-innermost (reorder_storage(c, x, y)) and vectorizes c by 4
+// then loads each pixel of the input as one dense vector.
+//
+// The padded variant drops the clamp to the image edge from every load
+// of the input. The caller binds an input that already extends past the
+// image by the pipeline's halo, filled by replicating the edge
+// (autotune::pad_from), so every load is in bounds and unclamped.
+//
+// The unorm16 variant stores every pyramid intermediate (downsampled,
+// downx, interpolated, upsampled, upsampledx) as normalized uint16,
+// round(v * 65535), and computes in float32: each Func converts what it
+// reads back to float. All of them stay within [0, 1] for inputs in
+// [0, 1]. Intermediates computed at root then move half the bytes.
+
+#include <Halide.h>
+
+#include <string>
+#include <vector>
+
+#include "pipeline.h"
+
+namespace pipelines {
+
+struct Interpolate : public Pipeline {
+    Halide::ImageParam input;
+    unsigned int levels;
+    bool interleaved, padded, unorm16;
+    Halide::Var x, y, c;
+    Halide::Func clamped, normalize, final;
+    std::vector<Halide::Func> downsampled, downx, interpolated, upsampled, upsampledx;
+};
+
+inline Interpolate make_interpolate(unsigned int levels = 3, bool interleaved = false, bool padded = false,
+                                    bool unorm16 = false) {
+    using namespace Halide;
+
+    Interpolate p;
+    NameCounter names;
+    p.name = std::string("interpolate") + (interleaved ? "_rgba" : "") + (padded ? "_padded" : "") +
+             (unorm16 ? "_unorm16" : "");
+    p.levels = levels;
+    p.interleaved = interleaved;
+    p.padded = padded;
+    p.unorm16 = unorm16;
+    p.input = ImageParam(Float(32), 3, "input");
+    Var x("x"), y("y"), c("c");
+    p.x = x;
+    p.y = y;
+    p.c = c;
+
+    std::vector<Func> &downsampled = p.downsampled, &downx = p.downx,
+        &interpolated = p.interpolated, &upsampled = p.upsampled, &upsampledx = p.upsampledx;
+    downsampled.resize(levels);
+    downx.resize(levels);
+    interpolated.resize(levels);
+    upsampled.resize(levels);
+    upsampledx.resize(levels);
+
+    downsampled[0] = make_func(p, names, "downsampled");
+    downx[0] = make_func(p, names, "downx");
+    interpolated[0] = make_func(p, names, "interpolated");
+    upsampled[0] = make_func(p, names, "upsampled");
+    upsampledx[0] = make_func(p, names, "upsampledx");
+
+    ImageParam input = p.input;
+    p.clamped = make_func(p, names, "clamped");
+    int xdim = interleaved ? 1 : 0, ydim = xdim + 1;
+    // Clamped to the bound buffer's region rather than from 0, so that a
+    // window of a larger image (harness/stream.h) reads as the image did
+    Expr cx = padded ? Expr(x) : clamp(x, input.min(xdim), input.min(xdim) + input.extent(xdim)-1);
+    Expr cy = padded ? Expr(y) : clamp(y, input.min(ydim), input.min(ydim) + input.extent(ydim)-1);
+    if (interleaved) {
+        // Dense RGBA: constant strides let neighbouring pixels be
+        // addressed at constant offsets
+        input.set_bounds(0, 0, 4).set_stride(1, 4);
+        p.clamped(x, y, c) = input(c, cx, cy);
+    } else {
+        p.clamped(x, y, c) = input(cx, cy, c);
+    }
+
+    // How intermediates are stored and read back
+    auto store = [=](Expr v) { return unorm16 ? cast<uint16_t>(clamp(v, 0.0f, 1.0f) * 65535.0f + 0.5f) : v; };
+    auto load = [=](Expr v) { return unorm16 ? cast<float>(v) * (1.0f / 65535.0f) : v; };
+
+    // The test cases' workaround for an llvm 3.3 bug; assumes the input
+    // alpha is zero or one.
+    downsampled[0](x, y, c) = store(p.clamped(x, y, c) * p.clamped(x, y, 3));
+
+    for (unsigned int l = 1; l < levels; ++l) {
+        downx[l] = make_func(p, names, "downx");
+        downsampled[l] = make_func(p, names, "downsampled");
+        downx[l](x, y, c) = store((load(downsampled[l-1](x*2-1, y, c)) +
+                                   2.0f * load(downsampled[l-1](x*2, y, c)) +
+                                   load(downsampled[l-1](x*2+1, y, c))) * 0.25f);
+        downsampled[l](x, y, c) = store((load(downx[l](x, y*2-1, c)) +
+                                         2.0f * load(downx[l](x, y*2, c)) +
+                                         load(downx[l](x, y*2+1, c))) * 0.25f);
+    }
+    interpolated[levels-1] = make_func(p, names, "interpolated");
+    interpolated[levels-1](x, y, c) = downsampled[levels-1](x, y, c);
+    for (unsigned int l = levels-2; l < levels; --l) {
+        upsampledx[l] = make_func(p, names, "upsampledx");
+        upsampled[l] = make_func(p, names, "upsampled");
+        interpolated[l] = make_func(p, names, "interpolated");
+        upsampledx[l](x, y, c) = store(select((x % 2) == 0,
+                                              load(interpolated[l+1](x/2, y, c)),
+                                              0.5f * (load(interpolated[l+1](x/2, y, c)) +
+                                                      load(interpolated[l+1](x/2+1, y, c)))));
+        upsampled[l](x, y, c) = store(select((y % 2) == 0,
+                                             load(upsampledx[l](x, y/2, c)),
+                                             0.5f * (load(upsampledx[l](x, y/2, c)) +
+                                                     load(upsampledx[l](x, y/2+1, c)))));
+        interpolated[l](x, y, c) = store(load(downsampled[l](x, y, c)) +
+                                         (1.0f - load(downsampled[l](x, y, 3))) * load(upsampled[l](x, y, c)));
+    }
+
+    p.normalize = make_func(p, names, "normalize");
+    p.normalize(x, y, c) = load(interpolated[0](x, y, c)) / load(interpolated[0](x, y, 3));
+
+    p.final = make_func(p, names, "final");
+    p.final(x, y, c) = p.normalize(x, y, c);
+
+    p.output = p.final;
+    p.stages["downsampled"] = schedule_names(p, downsampled);
+    p.stages["downx"] = schedule_names(p, downx);
+    p.stages["interpolated"] = schedule_names(p, interpolated);
+    p.stages["upsampled"] = schedule_names(p, upsampled);
+    p.stages["upsampledx"] = schedule_names(p, upsampledx);
+    // Intermediates have 4 channels and the output 3, so splitting c by
+    // more than 2 makes the tail shift read channels that don't exist.
+    p.dim_limit["c"] = 2;
+    p.size.push_back(2048);
+    p.size.push_back(2048);
+    p.size.push_back(3);
+    return p;
+}
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PIPELINES_PIPELINE_H
+#define PIPELINES_PIPELINE_H
+
+// The algorithms from the test cases, without schedules, as the search
+// driver and the benchmarks see them.
+
+#include <Halide.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pipelines {
+
+struct Pipeline {
+    std::string name;
+    Halide::Func output;
+
+    // Every Func that can be scheduled, by the name generated schedules
+    // use for it. Those are the names a fresh process running the test
+    // case would give them ("downsampled", "downsampled$2", ...), which
+    // need not match Func::name() once a process has built several
+    // pipelines.
+    std::map<std::string, Halide::Func> funcs;
+
+    // Largest split factor worth trying along a dimension, for dimensions
+    // with a small fixed extent such as color channels
+    std::map<std::string, int> dim_limit;
+
+    // Default output size
+    std::vector<int> size;
+
+    // Funcs built once per pyramid level, as schedule names indexed by
+    // level and grouped by the stage they implement ("downsampled" ->
+    // {"downsampled", "downsampled$2", ...})
+    std::map<std::string, std::vector<std::string> > stages;
+};
+
+// Hands out schedule names the way Halide uniquifies repeated Func
+// names: the first "f" is "f", the next "f$2", and so on.
+class NameCounter {
+    std::map<std::string, int> count;
+public:
+    std::string operator()(const std::string &base) {
+        int n = ++count[base];
+        if (n == 1) return base;
+        char buf[16];
+        snprintf(buf, sizeof(buf), "$%d", n);
+        return base + buf;
+    }
+};
+
+// Create a Func under the next schedule name for base and register it
+inline Halide::Func make_func(Pipeline &p, NameCounter &names, const std::string &base) {
+    std::string name = names(base);
+    Halide::Func f(name);
+    p.funcs[name] = f;
+    return f;
+}
+
+// The schedule names of funcs, which must have been made by make_func
+inline std::vector<std::string> schedule_names(const Pipeline &p, const std::vector<Halide::Func> &funcs) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < funcs.size(); i++) {
+        std::string name;
+        for (std::map<std::string, Halide::Func>::const_iterator it = p.funcs.begin(); it != p.funcs.end(); ++it) {
+            if (it->second.name() == funcs[i].name()) name = it->first;
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+}
+
+#endif
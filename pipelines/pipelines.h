@@ -0,0 +1,38 @@
+#ifndef PIPELINES_PIPELINES_H
+#define PIPELINES_PIPELINES_H
+
+// Build any of the pipelines by name.
+
+#include <string>
+
+#include "bilateral_grid.h"
+#include "blur.h"
+#include "interpolate.h"
+#include "pipeline.h"
+
+namespace pipelines {
+
+// Variants: interpolate_rgba reads interleaved RGBA input,
+// bilateral_grid_tiled builds its histogram from private per-row
+// histograms, blur_fixed blurs with widening sums and multiply-shift
+// division, interpolate_unorm16 stores its intermediates as normalized
+// uint16, and the _padded ones read a pre-padded input without clamping
+// (see each pipeline's header). levels only applies to the
+// interpolates. Returns a Pipeline with no output for unknown names.
+inline Pipeline make_pipeline(const std::string &name, unsigned int levels = 3) {
+    if (name == "interpolate") return make_interpolate(levels);
+    if (name == "interpolate_rgba") return make_interpolate(levels, true);
+    if (name == "interpolate_padded") return make_interpolate(levels, false, true);
+    if (name == "interpolate_unorm16") return make_interpolate(levels, false, false, true);
+    if (name == "bilateral_grid") return make_bilateral_grid();
+    if (name == "bilateral_grid_tiled") return make_bilateral_grid(4, 0.1f, true);
+    if (name == "bilateral_grid_padded") return make_bilateral_grid(4, 0.1f, false, true);
+    if (name == "blur") return make_blur();
+    if (name == "blur_fixed") return make_blur(true);
+    if (name == "blur_padded") return make_blur(false, true);
+    return Pipeline();
+}
+
+}
+
+#endif
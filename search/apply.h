@@ -0,0 +1,126 @@
+#ifndef SEARCH_APPLY_H
+#define SEARCH_APPLY_H
+
+// The Halide side of search/schedule.h: describe a pipeline to the
+// search, and apply a Schedule to it.
+
+#include <Halide.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pipelines/pipeline.h"
+#include "schedule.h"
+
+namespace search {
+
+// Dimensions, consumers and reductions of every Func the output depends
+// on, under the schedule names p uses. Implicit dimensions ("_0", ...),
+// which the generated schedules can't name, are left out.
+inline PipelineInfo describe(const pipelines::Pipeline &p) {
+    PipelineInfo info;
+    info.dim_limit = p.dim_limit;
+    info.stages = p.stages;
+
+    // Funcs that were made but ended up unused (the test cases overwrite
+    // some of their per-level Funcs) can't be scheduled
+    std::map<std::string, Halide::Internal::Function> used =
+        Halide::Internal::find_transitive_calls(p.output.function());
+    std::map<std::string, Halide::Func> funcs;
+    std::map<std::string, std::string> schedule_name;  // Func::name() -> schedule name
+    for (std::map<std::string, Halide::Func>::const_iterator it = p.funcs.begin(); it != p.funcs.end(); ++it) {
+        if (!used.count(it->second.name()) && it->second.name() != p.output.name()) continue;
+        funcs[it->first] = it->second;
+        schedule_name[it->second.name()] = it->first;
+        if (it->second.name() == p.output.name()) info.output = it->first;
+    }
+
+    for (std::map<std::string, Halide::Func>::const_iterator it = funcs.begin(); it != funcs.end(); ++it) {
+        Halide::Internal::Function fn = it->second.function();
+        FuncInfo f;
+        f.name = it->first;
+        for (size_t i = 0; i < fn.args().size(); i++) {
+            if (fn.args()[i][0] != '_') f.dims.push_back(fn.args()[i]);
+        }
+        f.reduction = fn.has_reduction_definition();
+        info.funcs.push_back(f);
+    }
+
+    for (std::map<std::string, Halide::Func>::const_iterator it = funcs.begin(); it != funcs.end(); ++it) {
+        std::map<std::string, Halide::Internal::Function> calls =
+            Halide::Internal::find_direct_calls(it->second.function());
+        for (std::map<std::string, Halide::Internal::Function>::iterator c = calls.begin(); c != calls.end(); ++c) {
+            if (!schedule_name.count(c->first) || c->first == it->second.name()) continue;
+            for (size_t i = 0; i < info.funcs.size(); i++) {
+                if (info.funcs[i].name == schedule_name[c->first]) info.funcs[i].consumers.push_back(it->first);
+            }
+        }
+    }
+    return info;
+}
+
+inline void _reorder(Halide::Func f, const std::vector<Halide::Var> &v) {
+    switch (v.size()) {
+    case 2: f.reorder(v[0], v[1]); break;
+    case 3: f.reorder(v[0], v[1], v[2]); break;
+    case 4: f.reorder(v[0], v[1], v[2], v[3]); break;
+    case 5: f.reorder(v[0], v[1], v[2], v[3], v[4]); break;
+    case 6: f.reorder(v[0], v[1], v[2], v[3], v[4], v[5]); break;
+    case 7: f.reorder(v[0], v[1], v[2], v[3], v[4], v[5], v[6]); break;
+    case 8: f.reorder(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]); break;
+    }
+}
+
+inline void _reorder_storage(Halide::Func f, const std::vector<Halide::Var> &v) {
+    switch (v.size()) {
+    case 2: f.reorder_storage(v[0], v[1]); break;
+    case 3: f.reorder_storage(v[0], v[1], v[2]); break;
+    case 4: f.reorder_storage(v[0], v[1], v[2], v[3]); break;
+    case 5: f.reorder_storage(v[0], v[1], v[2], v[3], v[4]); break;
+    }
+}
+
+// Schedule the Funcs of p as s says. s should have been through
+// conform() for this pipeline. Loop variables are Vars of the same name
+// ("x", "xi"), so compute_at can refer to another Func's loops.
+inline void apply(const Schedule &s, pipelines::Pipeline &p) {
+    using Halide::Var;
+
+    for (size_t i = 0; i < s.funcs.size(); i++) {
+        const FuncSchedule &f = s.funcs[i];
+        if (f.compute == FuncSchedule::Inline || !p.funcs.count(f.name)) continue;
+        Halide::Func func = p.funcs[f.name];
+
+        for (size_t j = 0; j < f.dims.size(); j++) {
+            if (f.split[j] <= 1) continue;
+            Var d(f.dims[j]);
+            func.split(d, d, Var(FuncSchedule::inner(f.dims[j])), f.split[j]);
+        }
+        std::vector<Var> order, storage;
+        for (size_t j = 0; j < f.order.size(); j++) order.push_back(Var(f.order[j]));
+        for (size_t j = 0; j < f.storage.size(); j++) storage.push_back(Var(f.storage[j]));
+        _reorder(func, order);
+        _reorder_storage(func, storage);
+
+        if (!f.vectorize.empty()) {
+            if (f.vector_width) func.vectorize(Var(f.vectorize), f.vector_width);
+            else func.vectorize(Var(f.vectorize));
+        }
+        if (!f.unroll.empty()) {
+            if (f.unroll_factor) func.unroll(Var(f.unroll), f.unroll_factor);
+            else func.unroll(Var(f.unroll));
+        }
+        if (!f.parallel.empty()) func.parallel(Var(f.parallel));
+
+        if (f.compute == FuncSchedule::Root) {
+            func.compute_root();
+        } else {
+            func.compute_at(p.funcs[f.at_func], Var(f.at_var));
+        }
+    }
+}
+
+}
+
+#endif
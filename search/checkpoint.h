@@ -0,0 +1,134 @@
+#ifndef SEARCH_CHECKPOINT_H
+#define SEARCH_CHECKPOINT_H
+
+// Save and restore the state of an Evolution between generations, so a
+// search that dies can carry on where it left off. A checkpoint holds
+// every evaluated schedule with its result (the cache), the population
+// as indices into it, the counters and the random number generator, so
+// a resumed search makes exactly the choices the original would have.
+// The driver's own settings go in as key/value pairs.
+//
+// The format is text, one record per line:
+//
+//   checkpoint 1
+//   meta <key> <value>           (any number)
+//   generation <g> <evaluated> <cache_hits>
+//   rng <std::mt19937 state>
+//   cache <n>
+//   eval <ok> <time> <peak_mem> <pruned> <realizations> <error>
+//   <Schedule::to_string() lines>
+//   end                          (eval ... end, n times)
+//   population <i> <j> ...
+
+#include <stdio.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "evolve.h"
+#include "schedule.h"
+
+namespace search {
+
+// Write to path + ".tmp" and rename, so a crash mid-write leaves the
+// previous checkpoint intact
+inline bool save_checkpoint(const std::string &path, const Evolution &e,
+                            const std::map<std::string, std::string> &meta) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp.c_str());
+        if (!out) return false;
+        out.precision(17);
+        out << "checkpoint 1\n";
+        for (std::map<std::string, std::string>::const_iterator it = meta.begin(); it != meta.end(); ++it) {
+            out << "meta " << it->first << " " << it->second << "\n";
+        }
+        out << "generation " << e.generation << " " << e.evaluated << " " << e.cache_hits << "\n";
+        out << "rng " << e.rng << "\n";
+
+        std::map<std::string, size_t> index;
+        out << "cache " << e.cache.size() << "\n";
+        for (std::map<std::string, Evaluation>::const_iterator it = e.cache.begin(); it != e.cache.end(); ++it) {
+            const Evaluation &v = it->second;
+            size_t i = index.size();
+            index[it->first] = i;
+            out << "eval " << v.ok << " " << v.time << " " << v.peak_mem << " " << v.pruned << " "
+                << v.realizations << " " << _or_dash(v.error) << "\n"
+                << it->first << "end\n";
+        }
+        out << "population";
+        for (size_t i = 0; i < e.population.size(); i++) {
+            out << " " << index[e.population[i].schedule.to_string()];
+        }
+        out << "\n";
+        if (!out) return false;
+    }
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Restore e (constructed for the same pipeline) from path. Returns false,
+// leaving e alone, if the file is missing or malformed.
+inline bool load_checkpoint(const std::string &path, Evolution &e,
+                            std::map<std::string, std::string> &meta) {
+    std::ifstream in(path.c_str());
+    std::string line, word;
+    if (!std::getline(in, line) || line != "checkpoint 1") return false;
+
+    Evolution r = e;
+    std::vector<std::string> keys;
+    r.cache.clear();
+    r.population.clear();
+    meta.clear();
+    bool have_population = false;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        fields >> word;
+        if (word == "meta") {
+            std::string key, value;
+            fields >> key;
+            std::getline(fields >> std::ws, value);
+            meta[key] = value;
+        } else if (word == "generation") {
+            fields >> r.generation >> r.evaluated >> r.cache_hits;
+        } else if (word == "rng") {
+            fields >> r.rng;
+        } else if (word == "cache") {
+            // the count is informational
+        } else if (word == "eval") {
+            Evaluation v;
+            fields >> v.ok >> v.time >> v.peak_mem >> v.pruned >> v.realizations;
+            std::getline(fields >> std::ws, v.error);
+            v.error = _from_dash(v.error);
+            std::string key;
+            while (std::getline(in, line) && line != "end") key += line + "\n";
+            if (line != "end") return false;
+            r.cache[key] = v;
+            keys.push_back(key);
+        } else if (word == "population") {
+            size_t i;
+            while (fields >> i) {
+                if (i >= keys.size()) return false;
+                Individual ind;
+                if (!Schedule::from_string(keys[i], ind.schedule)) return false;
+                ind.eval = r.cache[keys[i]];
+                r.population.push_back(ind);
+            }
+            have_population = true;
+        } else {
+            return false;
+        }
+        if (!fields && !fields.eof()) return false;
+    }
+    if (!have_population || r.population.empty()) return false;
+    // Recomputes Pareto ranks; the saved order is already sorted
+    r.sort();
+    e = r;
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef SEARCH_EVALUATE_H
+#define SEARCH_EVALUATE_H
+
+// Time Schedules in forked children, so the search runs in one process
+// without having to write, compile and launch a test case per candidate.
+// A child builds the pipeline afresh, applies the schedule and JIT
+// compiles it. A schedule that Halide rejects, that crashes or that runs
+// out of memory only takes the child down; one that runs too long is
+// killed.
+//
+// evaluate_forked measures a candidate once with progressive_measure. A
+// Worker keeps a compiled candidate alive and measures it on request,
+// for drivers that come back to the same candidate several times.
+// evaluate_configs measures a candidate under every configuration of a
+// multi-size, multi-thread objective (harness/configs.h).
+
+#include <Halide.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "apply.h"
+#include "evolve.h"
+#include "harness/configs.h"
+#include "harness/harness.h"
+#include "harness/progressive.h"
+#include "pipelines/pipelines.h"
+#include "schedule.h"
+
+namespace search {
+
+struct EvalOptions {
+    std::string pipeline;
+    unsigned int levels;
+    std::vector<int> size;
+    int trials;
+    double timeout;         // seconds per candidate, compilation included
+    size_t memory_limit;    // bytes of address space for the child, 0 = unlimited
+    double slack;           // progressive pruning: give up above incumbent * slack
+    bool quiet;             // discard the child's stderr (Halide's error messages)
+    std::vector<autotune::Config> configs;  // for evaluate_configs
+
+    EvalOptions() : levels(3), trials(3), timeout(60), memory_limit(0), slack(1.5), quiet(true) {}
+};
+
+// Read exactly len bytes before the deadline (0 waits forever). Returns
+// false on EOF, error or timeout, setting timed_out for the latter.
+inline bool _read_full(int fd, void *buf, size_t len, double deadline, bool &timed_out) {
+    size_t got = 0;
+    timed_out = false;
+    while (got < len) {
+        int remaining = deadline > 0 ? (int)((deadline - autotune::now()) * 1000) : -1;
+        if (deadline > 0 && remaining <= 0) {
+            timed_out = true;
+            return false;
+        }
+        pollfd pfd = {fd, POLLIN, 0};
+        int n = poll(&pfd, 1, remaining);
+        if (n <= 0) continue;
+        ssize_t r = read(fd, (char *)buf + got, len - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        got += r;
+    }
+    return true;
+}
+
+inline bool _write_full(int fd, const void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t w = write(fd, (const char *)buf + done, len - done);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        done += w;
+    }
+    return true;
+}
+
+// Why a child that didn't answer went away
+inline std::string _describe_exit(int status, bool timed_out) {
+    if (timed_out) return "timeout";
+    char buf[64];
+    if (WIFSIGNALED(status)) {
+        // Halide reports errors by aborting; running out of address
+        // space shows up as a failed allocation, which also aborts
+        if (WTERMSIG(status) == SIGABRT) return "error";
+        snprintf(buf, sizeof(buf), "signal %d", WTERMSIG(status));
+    } else {
+        snprintf(buf, sizeof(buf), "exit %d", WEXITSTATUS(status));
+    }
+    return buf;
+}
+
+// In a child: drop the pipes to every other worker, so that they see
+// end of file when the parent closes them
+inline void _close_other_fds(int keep1, int keep2) {
+    long max = sysconf(_SC_OPEN_MAX);
+    if (max < 0 || max > 4096) max = 4096;
+    for (int fd = 3; fd < max; fd++) {
+        if (fd != keep1 && fd != keep2) close(fd);
+    }
+}
+
+inline int _reap(pid_t pid) {
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return status;
+}
+
+// Set up a freshly forked child and compile s in it
+inline pipelines::Pipeline _child_compile(const Schedule &s, const EvalOptions &o) {
+    if (o.memory_limit) {
+        rlimit limit;
+        limit.rlim_cur = limit.rlim_max = o.memory_limit;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+    if (o.quiet) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 2);
+    }
+    pipelines::Pipeline p = pipelines::make_pipeline(o.pipeline, o.levels);
+    apply(s, p);
+    autotune::compile(p.output);
+    return p;
+}
+
+// What evaluate_forked's child sends back
+struct _ChildResult {
+    double time, predicted;
+    size_t peak_mem;
+    int pruned;
+    int realizations;
+};
+
+// Evaluate s, treating anything slower than incumbent * o.slack as
+// hopeless (an incumbent of 0 always measures at full size)
+inline Evaluation evaluate_forked(const Schedule &s, const EvalOptions &o, double incumbent) {
+    Evaluation e;
+    int fds[2];
+    if (pipe(fds)) {
+        e.error = strerror(errno);
+        return e;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        e.error = strerror(errno);
+        close(fds[0]);
+        close(fds[1]);
+        return e;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        pipelines::Pipeline p = _child_compile(s, o);
+        autotune::ProgressiveResult r = autotune::progressive_measure(p.output, o.size, o.trials, incumbent, o.slack);
+        _ChildResult result;
+        result.time = r.result.time;
+        result.predicted = r.predicted;
+        result.peak_mem = r.result.peak_mem;
+        if (r.pruned) {
+            // Measured at a smaller size; scale by pixels, as in halving
+            result.peak_mem = (size_t)(result.peak_mem * autotune::points(o.size) / autotune::points(r.sizes.back()));
+        }
+        result.pruned = r.pruned;
+        result.realizations = (int)r.sizes.size() * o.trials;
+        _exit(_write_full(fds[1], &result, sizeof(result)) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    // The child writes once, just before exiting
+    _ChildResult result;
+    bool timed_out;
+    bool ok = _read_full(fds[0], &result, sizeof(result), autotune::now() + o.timeout, timed_out);
+    close(fds[0]);
+    if (timed_out) kill(pid, SIGKILL);
+    int status = _reap(pid);
+
+    if (ok) {
+        e.ok = true;
+        e.time = result.predicted;
+        e.peak_mem = result.peak_mem;
+        e.pruned = result.pruned != 0;
+        e.realizations = result.realizations;
+    } else {
+        e.error = _describe_exit(status, timed_out);
+    }
+    return e;
+}
+
+// What evaluate_configs' child sends back per configuration
+struct _ConfigChildResult {
+    int ok;
+    double time;
+    size_t peak_mem, allocs, max_rss;
+};
+
+// Evaluate s under every configuration in o.configs, with one compilation
+// and o.trials trials each. The time is their weighted geometric mean and
+// peak_mem the largest of them; per_config, if given, gets each one's
+// result. o.timeout applies to each thread count separately. An empty
+// o.configs is an error.
+inline Evaluation evaluate_configs(const Schedule &s, const EvalOptions &o,
+                                   std::vector<autotune::ConfigResult> *per_config = NULL) {
+    Evaluation e;
+    size_t n = o.configs.size();
+    if (n == 0) {
+        e.error = "no configurations to evaluate";
+        return e;
+    }
+    int fds[2];
+    if (pipe(fds)) {
+        e.error = strerror(errno);
+        return e;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        e.error = strerror(errno);
+        close(fds[0]);
+        close(fds[1]);
+        return e;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        pipelines::Pipeline p = _child_compile(s, o);
+        std::vector<autotune::ConfigResult> results =
+            autotune::measure_configs(p.output, o.configs, o.trials, (unsigned int)ceil(o.timeout));
+        std::vector<_ConfigChildResult> reply(n);
+        for (size_t i = 0; i < n; i++) {
+            const autotune::Result &r = results[i].result;
+            _ConfigChildResult c = {results[i].ok, r.time, r.peak_mem, r.allocs, r.max_rss};
+            reply[i] = c;
+        }
+        _exit(_write_full(fds[1], &reply[0], n * sizeof(reply[0])) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    // Each thread count's grandchild has o.timeout to itself
+    std::vector<_ConfigChildResult> reply(n);
+    bool timed_out;
+    bool ok = _read_full(fds[0], &reply[0], n * sizeof(reply[0]), autotune::now() + o.timeout * n, timed_out);
+    close(fds[0]);
+    if (timed_out) kill(pid, SIGKILL);
+    int status = _reap(pid);
+    if (!ok) {
+        e.error = _describe_exit(status, timed_out);
+        return e;
+    }
+
+    std::vector<autotune::ConfigResult> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i].ok = reply[i].ok != 0;
+        results[i].result.time = reply[i].time;
+        results[i].result.peak_mem = reply[i].peak_mem;
+        results[i].result.allocs = reply[i].allocs;
+        results[i].result.max_rss = reply[i].max_rss;
+        if (!results[i].ok && e.error.empty()) {
+            char threads[16];
+            snprintf(threads, sizeof(threads), "@%d", o.configs[i].threads);
+            e.error = "failed at " + autotune::format_size(o.configs[i].size) + threads;
+        }
+    }
+    if (per_config) *per_config = results;
+    e.ok = e.error.empty();
+    e.time = e.ok ? autotune::aggregate_time(o.configs, results) : 0;
+    e.peak_mem = autotune::aggregate_peak_mem(results);
+    e.realizations = n * o.trials;
+    return e;
+}
+
+// One measurement made by a Worker
+struct Measurement {
+    double time;                  // fastest trial
+    std::vector<double> samples;  // every trial
+    size_t peak_mem;
+};
+
+// A child process holding one compiled candidate. start() forks and
+// returns at once, so several candidates can compile in parallel;
+// ready() waits for the compilation to finish. Each measure() binds
+// inputs and output for the requested size and runs the trials.
+class Worker {
+    pid_t pid;
+    int to_child, from_child;
+    const EvalOptions *options;
+
+    // Protocol: the child writes one byte when compiled; then for each
+    // request (dims, size[4], trials) it answers with (peak_mem, n)
+    // followed by n samples. dims is at most 4 and trials at least 1.
+    struct Request { int dims, size[4], trials; };
+    struct Reply { size_t peak_mem; int n; };
+
+    static void serve(const Schedule &s, const EvalOptions &o, int in, int out) {
+        pipelines::Pipeline p = _child_compile(s, o);
+        char ready = 1;
+        if (!_write_full(out, &ready, 1)) _exit(1);
+        Request req;
+        bool timed_out;
+        while (_read_full(in, &req, sizeof(req), 0, timed_out)) {
+            std::vector<int> size(req.size, req.size + std::min(std::max(req.dims, 0), 4));
+            Halide::Buffer output = autotune::bind(p.output, size);
+            autotune::Result r = autotune::measure(p.output, output, std::max(req.trials, 1));
+            Reply reply = {r.peak_mem, (int)r.samples.size()};
+            if (!_write_full(out, &reply, sizeof(reply)) ||
+                !_write_full(out, r.samples.data(), r.samples.size() * sizeof(double))) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    // Kill the child if still needed, collect it and record why it's gone
+    void fail(bool timed_out) {
+        if (timed_out) kill(pid, SIGKILL);
+        close(to_child);
+        close(from_child);
+        error = _describe_exit(_reap(pid), timed_out);
+        pid = -1;
+    }
+
+public:
+    std::string error;  // set once the child is gone unexpectedly
+
+    Worker() : pid(-1), to_child(-1), from_child(-1), options(NULL) {}
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
+    bool alive() const { return pid > 0; }
+
+    bool start(const Schedule &s, const EvalOptions &o) {
+        options = &o;
+        int down[2], up[2];
+        if (pipe(down)) {
+            error = strerror(errno);
+            return false;
+        }
+        if (pipe(up)) {
+            error = strerror(errno);
+            close(down[0]);
+            close(down[1]);
+            return false;
+        }
+        fflush(stdout);
+        fflush(stderr);
+        pid = fork();
+        if (pid < 0) {
+            error = strerror(errno);
+            close(down[0]); close(down[1]); close(up[0]); close(up[1]);
+            return false;
+        }
+        if (pid == 0) {
+            _close_other_fds(down[0], up[1]);
+            serve(s, o, down[0], up[1]);
+        }
+        close(down[0]);
+        close(up[1]);
+        to_child = down[1];
+        from_child = up[0];
+        // Don't let a worker that died take us down with SIGPIPE
+        signal(SIGPIPE, SIG_IGN);
+        return true;
+    }
+
+    bool ready() {
+        if (!alive()) return false;
+        char byte;
+        bool timed_out;
+        if (_read_full(from_child, &byte, 1, autotune::now() + options->timeout, timed_out)) return true;
+        fail(timed_out);
+        return false;
+    }
+
+    // Sizes of more than 4 dimensions are cut to 4, and fewer than one
+    // trial is one
+    bool measure(const std::vector<int> &size, int trials, Measurement &m) {
+        if (!alive()) return false;
+        Request req = {(int)std::min(size.size(), (size_t)4), {0, 0, 0, 0}, std::max(trials, 1)};
+        for (int i = 0; i < req.dims; i++) req.size[i] = size[i];
+        Reply reply;
+        bool timed_out = false;
+        double deadline = autotune::now() + options->timeout;
+        if (!_write_full(to_child, &req, sizeof(req)) ||
+            !_read_full(from_child, &reply, sizeof(reply), deadline, timed_out)) {
+            fail(timed_out);
+            return false;
+        }
+        if (reply.n < 1) {
+            error = "no samples";
+            stop();
+            return false;
+        }
+        m.samples.resize(reply.n);
+        if (!_read_full(from_child, &m.samples[0], reply.n * sizeof(double), deadline, timed_out)) {
+            fail(timed_out);
+            return false;
+        }
+        m.time = autotune::minimum(m.samples);
+        m.peak_mem = reply.peak_mem;
+        return true;
+    }
+
+    // Close the request pipe; the child exits when it sees that
+    void stop() {
+        if (!alive()) return;
+        close(to_child);
+        close(from_child);
+        _reap(pid);
+        pid = -1;
+    }
+
+    ~Worker() { stop(); }
+};
+
+}
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef SEARCH_EVOLVE_H
+#define SEARCH_EVOLVE_H
+
+// Evolutionary search over Schedules: tournament selection, per-Func
+// uniform crossover, a mutation per directive, elitism, and a cache so
+// that no schedule is evaluated twice. Each generation's new schedules
+// are timed as one batch, by whatever the caller passes in
+// (search/evaluate.h and search/halving.h).
+
+#include <math.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "schedule.h"
+
+namespace search {
+
+struct Evaluation {
+    bool ok;
+    double time;          // seconds; the extrapolated time if pruned
+    size_t peak_mem;      // bytes
+    bool pruned;          // stopped early as hopeless
+    std::string error;    // why it failed, if it did
+    size_t realizations;  // trials it took, over all sizes
+
+    Evaluation() : ok(false), time(0), peak_mem(0), pruned(false), realizations(0) {}
+};
+
+// Whether a is strictly better than b: working beats failing, then faster
+inline bool better(const Evaluation &a, const Evaluation &b) {
+    if (a.ok != b.ok) return a.ok;
+    return a.ok && a.time < b.time;
+}
+
+// Whether a is at least as good as b on time and peak memory, and
+// better on one of them
+inline bool dominates(const Evaluation &a, const Evaluation &b) {
+    if (!a.ok || !b.ok) return a.ok && !b.ok;
+    return a.time <= b.time && a.peak_mem <= b.peak_mem &&
+           (a.time < b.time || a.peak_mem < b.peak_mem);
+}
+
+struct Individual {
+    Schedule schedule;
+    Evaluation eval;
+    int rank;         // Pareto front it is on, 0 = nondominated
+    double crowding;  // distance to its neighbours on that front
+
+    Individual() : rank(0), crowding(0) {}
+};
+
+// Nondominated sorting and crowding distances, as in NSGA-II. Failed
+// individuals all go on a last front of their own.
+inline void rank_pareto(std::vector<Individual> &v) {
+    std::vector<bool> placed(v.size(), false);
+    size_t remaining = v.size();
+    for (int rank = 0; remaining; rank++) {
+        std::vector<size_t> front;
+        for (size_t i = 0; i < v.size(); i++) {
+            if (placed[i]) continue;
+            bool dominated = false;
+            for (size_t j = 0; j < v.size() && !dominated; j++) {
+                dominated = !placed[j] && j != i && dominates(v[j].eval, v[i].eval);
+            }
+            if (!dominated) front.push_back(i);
+        }
+        for (size_t k = 0; k < front.size(); k++) {
+            placed[front[k]] = true;
+            v[front[k]].rank = rank;
+            v[front[k]].crowding = 0;
+        }
+        remaining -= front.size();
+
+        // Crowding: the normalized size of the box between the two
+        // neighbours along each objective; the extremes are kept
+        for (int objective = 0; objective < 2; objective++) {
+            auto value = [&](size_t i) {
+                return objective ? (double)v[i].eval.peak_mem : v[i].eval.time;
+            };
+            std::sort(front.begin(), front.end(), [&](size_t a, size_t b) { return value(a) < value(b); });
+            double range = value(front.back()) - value(front.front());
+            v[front.front()].crowding = v[front.back()].crowding = INFINITY;
+            for (size_t k = 1; k + 1 < front.size(); k++) {
+                if (range > 0) v[front[k]].crowding += (value(front[k + 1]) - value(front[k - 1])) / range;
+            }
+        }
+    }
+}
+
+// Random schedules and the genetic operators, all of which leave their
+// result conformed to the pipeline
+class Operators {
+public:
+    const PipelineInfo &info;
+    std::mt19937 &rng;
+
+    Operators(const PipelineInfo &info, std::mt19937 &rng) : info(info), rng(rng) {}
+
+    int uniform(int n) { return std::uniform_int_distribution<int>(0, n - 1)(rng); }
+    bool coin(double p) { return std::uniform_real_distribution<double>(0, 1)(rng) < p; }
+
+    template<typename T>
+    const T &pick(const std::vector<T> &v) { return v[uniform((int)v.size())]; }
+
+    int factor(const std::string &dim, int lo, int hi) {
+        std::vector<int> f;
+        for (int k = lo; k <= hi && k <= info.limit(dim); k *= 2) f.push_back(k);
+        return f.empty() ? 1 : pick(f);
+    }
+
+    // Everything compute_root, nothing else: the usual starting point
+    Schedule root_schedule() {
+        Schedule s;
+        for (size_t i = 0; i < info.funcs.size(); i++) {
+            FuncSchedule f;
+            f.name = info.funcs[i].name;
+            f.compute = FuncSchedule::Root;
+            s.funcs.push_back(f);
+        }
+        conform(s, info);
+        return s;
+    }
+
+    void randomize_split(FuncSchedule &f, size_t d) {
+        f.split[d] = coin(0.5) ? factor(f.dims[d], 2, 64) : 1;
+        if (d < f.halve.size()) f.halve[d] = coin(0.5);
+    }
+
+    void randomize_vectorize(FuncSchedule &f) {
+        if (f.order.empty() || coin(0.3)) {
+            f.vectorize = "";
+            f.vector_width = 0;
+            return;
+        }
+        // Almost always the innermost loop
+        f.vectorize = coin(0.8) ? f.order[0] : pick(f.order);
+        f.vector_width = factor(f.dim_of(f.vectorize), 2, 8);
+    }
+
+    void randomize_unroll(FuncSchedule &f) {
+        if (f.order.empty() || coin(0.6)) {
+            f.unroll = "";
+            f.unroll_factor = 0;
+            return;
+        }
+        f.unroll = f.order[std::min<size_t>(uniform(2), f.order.size() - 1)];
+        f.unroll_factor = factor(f.dim_of(f.unroll), 2, 4);
+    }
+
+    void randomize_parallel(FuncSchedule &f) {
+        // Usually the outermost loop
+        if (f.order.empty() || coin(0.5)) f.parallel = "";
+        else f.parallel = coin(0.8) ? f.order.back() : pick(f.order);
+    }
+
+    void randomize_compute(FuncSchedule &f) {
+        const FuncInfo &fi = *info.find(f.name);
+        int choice = uniform(3);
+        if (choice == 0 && !fi.reduction) {
+            f.compute = FuncSchedule::Inline;
+        } else if (choice == 2 && fi.name != info.output) {
+            f.compute = FuncSchedule::At;
+            f.at_func = pick(info.compute_targets(fi));
+            f.at_var = "";  // conform picks one of the target's loops
+        } else {
+            f.compute = FuncSchedule::Root;
+        }
+    }
+
+    void randomize_at_var(Schedule &s, FuncSchedule &f) {
+        const FuncSchedule *target = s.find(f.at_func);
+        if (f.compute == FuncSchedule::At && target && !target->order.empty()) {
+            f.at_var = pick(target->order);
+        }
+    }
+
+    Schedule random_schedule() {
+        Schedule s = root_schedule();
+        for (size_t i = 0; i < s.funcs.size(); i++) {
+            FuncSchedule &f = s.funcs[i];
+            for (size_t d = 0; d < f.dims.size(); d++) randomize_split(f, d);
+            f.order = f.default_order();
+            if (coin(0.5)) std::shuffle(f.order.begin(), f.order.end(), rng);
+            if (coin(0.3)) std::shuffle(f.storage.begin(), f.storage.end(), rng);
+            randomize_vectorize(f);
+            randomize_unroll(f);
+            randomize_parallel(f);
+            randomize_compute(f);
+        }
+        conform(s, info);
+        for (size_t i = 0; i < s.funcs.size(); i++) randomize_at_var(s, s.funcs[i]);
+        return s;
+    }
+
+    // Each Func's schedule comes from one parent or the other
+    Schedule crossover(const Schedule &a, const Schedule &b) {
+        Schedule child = a;
+        for (size_t i = 0; i < child.funcs.size(); i++) {
+            const FuncSchedule *other = b.find(child.funcs[i].name);
+            if (other && coin(0.5)) child.funcs[i] = *other;
+        }
+        conform(child, info);
+        return child;
+    }
+
+    // Change one directive of one Func
+    void mutate(Schedule &s) {
+        if (s.funcs.empty()) return;
+        FuncSchedule &f = s.funcs[uniform((int)s.funcs.size())];
+        switch (uniform(8)) {
+        case 0:
+            if (!f.dims.empty()) {
+                size_t d = uniform((int)f.dims.size());
+                randomize_split(f, d);
+            }
+            break;
+        case 1:
+        case 2:
+            // Move one loop somewhere else in the nest
+            if (f.order.size() > 1) {
+                size_t from = uniform((int)f.order.size());
+                std::string var = f.order[from];
+                f.order.erase(f.order.begin() + from);
+                f.order.insert(f.order.begin() + uniform((int)f.order.size() + 1), var);
+            }
+            break;
+        case 3:
+            if (f.storage.size() > 1) {
+                std::swap(f.storage[uniform((int)f.storage.size())], f.storage[uniform((int)f.storage.size())]);
+            }
+            break;
+        case 4: randomize_vectorize(f); break;
+        case 5: randomize_unroll(f); break;
+        case 6: randomize_parallel(f); break;
+        case 7: {
+            std::string name = f.name;
+            randomize_compute(f);
+            conform(s, info);
+            randomize_at_var(s, *s.find(name));
+            return;
+        }
+        }
+        conform(s, info);
+    }
+};
+
+class Evolution {
+public:
+    // Evaluates a batch of new schedules, returning results in order
+    typedef std::function<std::vector<Evaluation>(const std::vector<Schedule> &)> Evaluator;
+
+    PipelineInfo info;
+    bool pareto;  // select on time and peak memory, not time alone
+    size_t population_size;
+    size_t elite;
+    double crossover_rate;
+    int generation;
+    std::vector<Individual> population;  // best first
+    std::map<std::string, Evaluation> cache;
+    size_t evaluated, cache_hits;
+    std::mt19937 rng;
+
+    Evolution(const PipelineInfo &info, size_t population_size = 32, unsigned int seed = 0)
+        : info(info), pareto(false), population_size(population_size), elite(2), crossover_rate(0.7),
+          generation(0), evaluated(0), cache_hits(0), rng(seed) {}
+
+    // The fastest individual (with pareto, not necessarily the first)
+    const Individual &best() const {
+        const Individual *b = &population.front();
+        for (size_t i = 1; i < population.size(); i++) {
+            if (better(population[i].eval, b->eval)) b = &population[i];
+        }
+        return *b;
+    }
+
+    // Fill in the evaluations of individuals [first, end) from the cache,
+    // and evaluate the rest as one batch
+    void evaluate(std::vector<Individual> &individuals, size_t first, Evaluator &eval) {
+        std::vector<Schedule> batch;
+        std::vector<std::string> keys;
+        for (size_t i = first; i < individuals.size(); i++) {
+            std::string key = individuals[i].schedule.to_string();
+            if (cache.count(key)) {
+                cache_hits++;
+            } else if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(key);
+                batch.push_back(individuals[i].schedule);
+            }
+        }
+        if (!batch.empty()) {
+            std::vector<Evaluation> results = eval(batch);
+            for (size_t i = 0; i < batch.size(); i++) cache[keys[i]] = results[i];
+            evaluated += batch.size();
+        }
+        for (size_t i = first; i < individuals.size(); i++) {
+            individuals[i].eval = cache[individuals[i].schedule.to_string()];
+        }
+    }
+
+    // Generation 0: the seeds, an all-root schedule and random schedules
+    void start(const std::vector<Schedule> &seeds, Evaluator eval) {
+        Operators ops(info, rng);
+        std::vector<Schedule> schedules;
+        for (size_t i = 0; i < seeds.size() && schedules.size() < population_size; i++) {
+            Schedule s = seeds[i];
+            conform(s, info);
+            schedules.push_back(s);
+        }
+        schedules.push_back(ops.root_schedule());
+        while (schedules.size() < population_size) schedules.push_back(ops.random_schedule());
+
+        population.clear();
+        for (size_t i = 0; i < schedules.size(); i++) {
+            Individual ind;
+            ind.schedule = schedules[i];
+            population.push_back(ind);
+        }
+        evaluate(population, 0, eval);
+        sort();
+        generation = 0;
+    }
+
+    void step(Evaluator eval) {
+        Operators ops(info, rng);
+        std::vector<Individual> next(population.begin(), population.begin() + std::min(elite, population.size()));
+        std::map<std::string, bool> seen;
+        for (size_t i = 0; i < next.size(); i++) seen[next[i].schedule.to_string()] = true;
+
+        while (next.size() < population_size) {
+            const Individual &a = tournament(ops), &b = tournament(ops);
+            Individual child;
+            child.schedule = ops.coin(crossover_rate) ? ops.crossover(a.schedule, b.schedule) : a.schedule;
+            // At least one mutation; more, with decreasing probability,
+            // and until the child differs from the rest of the generation
+            ops.mutate(child.schedule);
+            for (int tries = 0; tries < 20; tries++) {
+                if (!ops.coin(0.3) && !seen.count(child.schedule.to_string())) break;
+                ops.mutate(child.schedule);
+            }
+            seen[child.schedule.to_string()] = true;
+            next.push_back(child);
+        }
+        evaluate(next, std::min(elite, population.size()), eval);
+        population = next;
+        sort();
+        generation++;
+    }
+
+    // Best first. With pareto, that is by front, then spread along it, so
+    // elitism keeps the extremes of the first front.
+    void sort() {
+        if (pareto) rank_pareto(population);
+        std::stable_sort(population.begin(), population.end(),
+                         [this](const Individual &a, const Individual &b) { return fitter(a, b); });
+    }
+
+    size_t failed() const {
+        size_t n = 0;
+        for (size_t i = 0; i < population.size(); i++) n += !population[i].eval.ok;
+        return n;
+    }
+
+private:
+    const Individual &tournament(Operators &ops, int size = 3) {
+        const Individual *winner = &population[ops.uniform((int)population.size())];
+        for (int i = 1; i < size; i++) {
+            const Individual *c = &population[ops.uniform((int)population.size())];
+            if (fitter(*c, *winner)) winner = c;
+        }
+        return *winner;
+    }
+
+    bool fitter(const Individual &a, const Individual &b) const {
+        if (!pareto || a.eval.ok != b.eval.ok) return better(a.eval, b.eval);
+        if (a.rank != b.rank) return a.rank < b.rank;
+        if (a.crowding != b.crowding) return a.crowding > b.crowding;
+        return better(a.eval, b.eval);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SEARCH_HALVING_H
+#define SEARCH_HALVING_H
+
+// Successive halving over a batch of candidates. Every candidate gets one
+// cheap measurement: few trials at the smallest size of the ladder. The
+// best 1/eta survive to the next round, which doubles the trials and
+// moves one step up the size ladder. When one candidate is left at full
+// size, it is measured until its timing is tight. Most realizations are
+// spent on the candidates that might win, instead of AUTOTUNE_TRIALS
+// full-size runs on every one of them.
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "evaluate.h"
+#include "evolve.h"
+#include "harness/progressive.h"
+#include "harness/stats.h"
+#include "schedule.h"
+
+namespace search {
+
+struct HalvingOptions {
+    int eta;            // keep the best 1/eta each round
+    int start;          // smallest edge of the size ladder
+    int min_trials;     // trials in the first round
+    int max_trials;     // most trials in one measurement of the winner
+    double tolerance;   // stop once the winner's 95% interval is within this fraction
+
+    HalvingOptions() : eta(2), start(256), min_trials(1), max_trials(64), tolerance(0.02) {}
+};
+
+// Relative half-width of the 95% confidence interval of the mean
+inline double relative_interval(const std::vector<double> &samples) {
+    if (samples.size() < 3) return INFINITY;
+    double dof = samples.size() - 1;
+    return autotune::student_t_critical(0.05, dof) * autotune::stddev(samples) /
+           sqrt((double)samples.size()) / autotune::mean(samples);
+}
+
+// Race the batch and return an Evaluation per candidate, in order.
+// Candidates that were dropped before full size are marked pruned, with
+// their time extrapolated to full size the way progressive_measure does.
+inline std::vector<Evaluation> successive_halving(const std::vector<Schedule> &batch, const EvalOptions &o,
+                                                  const HalvingOptions &h) {
+    size_t n = batch.size();
+    std::vector<Evaluation> results(n);
+    std::vector<Worker> workers(n);
+    std::vector<std::vector<double> > points(n), times(n), samples(n);
+
+    // Compile everything in parallel
+    for (size_t i = 0; i < n; i++) {
+        if (!workers[i].start(batch[i], o)) results[i].error = workers[i].error;
+    }
+    std::vector<size_t> alive;
+    for (size_t i = 0; i < n; i++) {
+        if (workers[i].ready()) alive.push_back(i);
+        else results[i].error = workers[i].error;
+    }
+
+    std::vector<std::vector<int> > ladder = autotune::size_ladder(o.size, h.start);
+    double full = autotune::points(o.size);
+    int trials = h.min_trials;
+    for (size_t round = 0; !alive.empty(); round++) {
+        size_t step = std::min(round, ladder.size() - 1);
+        bool at_full = step == ladder.size() - 1;
+
+        for (size_t k = 0; k < alive.size(); k++) {
+            size_t i = alive[k];
+            Measurement m;
+            if (!workers[i].measure(ladder[step], trials, m)) {
+                results[i].ok = false;
+                results[i].error = workers[i].error;
+                continue;
+            }
+            Evaluation &e = results[i];
+            e.realizations += trials;
+            e.ok = true;
+            if (at_full) {
+                e.peak_mem = samples[i].empty() ? m.peak_mem : std::max(e.peak_mem, m.peak_mem);
+                samples[i].insert(samples[i].end(), m.samples.begin(), m.samples.end());
+                e.time = autotune::minimum(samples[i]);
+                e.pruned = false;
+            } else {
+                points[i].push_back(autotune::points(ladder[step]));
+                times[i].push_back(m.time);
+                e.time = autotune::extrapolate(points[i], times[i], full);
+                // Intermediates grow with the output, so scale memory by pixels
+                e.peak_mem = (size_t)(m.peak_mem * full / points[i].back());
+                e.pruned = true;
+            }
+        }
+
+        std::vector<size_t> survivors;
+        for (size_t k = 0; k < alive.size(); k++) {
+            if (results[alive[k]].ok) survivors.push_back(alive[k]);
+        }
+        std::stable_sort(survivors.begin(), survivors.end(),
+                         [&](size_t a, size_t b) { return results[a].time < results[b].time; });
+
+        if (survivors.size() <= 1 && at_full) {
+            // Down to the winner: measure it until its time is tight
+            if (survivors.empty() || trials >= h.max_trials ||
+                relative_interval(samples[survivors[0]]) <= h.tolerance) {
+                break;
+            }
+        } else {
+            // Keep the top 1/eta, but never fewer than one
+            size_t keep = std::max<size_t>(1, (survivors.size() + h.eta - 1) / h.eta);
+            if (survivors.size() > 1 && keep == survivors.size()) keep--;
+            for (size_t k = keep; k < survivors.size(); k++) workers[survivors[k]].stop();
+            survivors.resize(keep);
+        }
+        alive = survivors;
+        trials = std::min(trials * 2, h.max_trials);
+    }
+    return results;
+}
+
+}
+
+#endif
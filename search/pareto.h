@@ -0,0 +1,110 @@
+#ifndef SEARCH_PARETO_H
+#define SEARCH_PARETO_H
+
+// The time / peak memory trade-off over everything a search evaluated.
+// The front is every working schedule that no other beats on both, from
+// fastest (and hungriest) to leanest. Deployment picks from it, e.g. the
+// fastest schedule under 256MB.
+//
+// A front file lists the members fastest first, each as a header line
+// followed by the schedule in Schedule::to_string form:
+//
+//   # time <seconds> peak_mem <bytes>
+//   <schedule lines>
+//   <blank line>
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "evolve.h"
+#include "schedule.h"
+
+namespace search {
+
+struct FrontEntry {
+    Schedule schedule;
+    Evaluation eval;
+};
+
+// The nondominated evaluations in cache (keyed by Schedule::to_string),
+// fastest first. Pruned schedules are left out: their times and memory
+// are extrapolations.
+inline std::vector<FrontEntry> pareto_front(const std::map<std::string, Evaluation> &cache) {
+    std::vector<FrontEntry> candidates;
+    for (std::map<std::string, Evaluation>::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+        if (!it->second.ok || it->second.pruned) continue;
+        FrontEntry e;
+        if (!Schedule::from_string(it->first, e.schedule)) continue;
+        e.eval = it->second;
+        candidates.push_back(e);
+    }
+    std::vector<FrontEntry> front;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        bool dominated = false;
+        for (size_t j = 0; j < candidates.size() && !dominated; j++) {
+            dominated = dominates(candidates[j].eval, candidates[i].eval);
+        }
+        if (!dominated) front.push_back(candidates[i]);
+    }
+    std::sort(front.begin(), front.end(), [](const FrontEntry &a, const FrontEntry &b) {
+        return a.eval.time < b.eval.time;
+    });
+    return front;
+}
+
+// The fastest member using at most budget bytes, or NULL
+inline const FrontEntry *fastest_within(const std::vector<FrontEntry> &front, size_t budget) {
+    for (size_t i = 0; i < front.size(); i++) {
+        if (front[i].eval.peak_mem <= budget) return &front[i];
+    }
+    return NULL;
+}
+
+inline bool save_front(const std::string &path, const std::vector<FrontEntry> &front) {
+    std::ofstream out(path.c_str());
+    out.precision(10);
+    for (size_t i = 0; i < front.size(); i++) {
+        out << "# time " << front[i].eval.time << " peak_mem " << front[i].eval.peak_mem << "\n"
+            << front[i].schedule.to_string() << "\n";
+    }
+    return (bool)out;
+}
+
+inline bool load_front(const std::string &path, std::vector<FrontEntry> &front) {
+    std::ifstream in(path.c_str());
+    if (!in) return false;
+    front.clear();
+    std::string line, text;
+    FrontEntry e;
+    bool open = false;
+    while (true) {
+        bool more = (bool)std::getline(in, line);
+        if (!more || line.compare(0, 2, "# ") == 0) {
+            if (open) {
+                if (!Schedule::from_string(text, e.schedule)) return false;
+                front.push_back(e);
+            }
+            if (!more) break;
+            std::istringstream header(line.substr(2));
+            std::string key;
+            e = FrontEntry();
+            e.eval.ok = true;
+            header >> key >> e.eval.time >> key >> e.eval.peak_mem;
+            text.clear();
+            open = true;
+        } else {
+            text += line + "\n";
+        }
+    }
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,566 @@
+#ifndef SEARCH_SCHEDULE_H
+#define SEARCH_SCHEDULE_H
+
+// Schedules as the search manipulates them. Each Func gets at most one
+// split per dimension and the directive vocabulary of the generated
+// schedules: split, reorder, reorder_storage, vectorize, unroll,
+// parallel, compute_at and compute_root (anything else is inlined).
+// Nothing in here depends on Halide; search/apply.h turns a Schedule
+// into Halide calls.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace search {
+
+// What the search needs to know about one Func of a pipeline
+struct FuncInfo {
+    std::string name;
+    std::vector<std::string> dims;       // pure dimensions, innermost first
+    std::vector<std::string> consumers;  // Funcs that call this one
+    bool reduction;                      // has an update step, so can't be inlined
+    bool family;                         // stands for one Func per pyramid level (search/template.h)
+
+    FuncInfo() : reduction(false), family(false) {}
+};
+
+struct PipelineInfo {
+    std::vector<FuncInfo> funcs;
+    std::string output;
+    std::map<std::string, int> dim_limit;  // largest sensible split factor per dimension
+    std::map<std::string, std::vector<std::string> > stages;  // as in pipelines::Pipeline
+
+    const FuncInfo *find(const std::string &name) const {
+        for (size_t i = 0; i < funcs.size(); i++) {
+            if (funcs[i].name == name) return &funcs[i];
+        }
+        return NULL;
+    }
+
+    int limit(const std::string &dim) const {
+        std::map<std::string, int>::const_iterator it = dim_limit.find(dim);
+        return it == dim_limit.end() ? 1 << 30 : it->second;
+    }
+
+    // Funcs f may be computed at: its consumer when it has only one, and
+    // the output, whose loops enclose every use.
+    std::vector<std::string> compute_targets(const FuncInfo &f) const {
+        std::vector<std::string> targets;
+        if (f.consumers.size() == 1) targets.push_back(f.consumers[0]);
+        if (f.name != output && (targets.empty() || targets[0] != output)) {
+            targets.push_back(output);
+        }
+        return targets;
+    }
+};
+
+struct FuncSchedule {
+    enum Compute { Inline, Root, At };
+
+    std::string name;
+    std::vector<std::string> dims;      // pure dimensions, innermost first
+    std::vector<int> split;             // factor per dimension, 1 = not split
+    std::vector<int> halve;             // families only: 1 halves that split per level
+    std::vector<std::string> order;     // loop variables, innermost first
+    std::vector<std::string> storage;   // dimensions, innermost first
+    std::string vectorize;              // loop variable, empty for none
+    int vector_width;                   // 0 vectorizes the whole loop
+    std::string unroll;
+    int unroll_factor;
+    std::string parallel;
+    Compute compute;
+    std::string at_func, at_var;
+
+    FuncSchedule() : vector_width(0), unroll_factor(0), compute(Inline) {}
+
+    // Splitting dimension d makes d the outer loop and d + "i" the inner one
+    static std::string inner(const std::string &dim) { return dim + "i"; }
+
+    // The dimension a loop variable belongs to
+    std::string dim_of(const std::string &var) const {
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (var == dims[i] || (split[i] > 1 && var == inner(dims[i]))) return dims[i];
+        }
+        return "";
+    }
+
+    // Loop variables in the order Halide creates them (no reorder):
+    // each split's inner variable just inside its outer one.
+    std::vector<std::string> default_order() const {
+        std::vector<std::string> vars;
+        for (size_t i = 0; i < dims.size(); i++) {
+            if (split[i] > 1) vars.push_back(inner(dims[i]));
+            vars.push_back(dims[i]);
+        }
+        return vars;
+    }
+
+    bool has_var(const std::string &var) const {
+        return std::find(order.begin(), order.end(), var) != order.end();
+    }
+};
+
+inline std::string _or_dash(const std::string &s) { return s.empty() ? "-" : s; }
+inline std::string _from_dash(const std::string &s) { return s == "-" ? "" : s; }
+
+// The C++ name to_cpp gives a Func's loop variable
+inline std::string _var_name(const std::map<std::string, std::string> &names,
+                             const std::string &func, const std::string &var) {
+    std::map<std::string, std::string>::const_iterator it = names.find(func + "." + var);
+    return it == names.end() ? var : it->second;
+}
+
+struct Schedule {
+    std::vector<FuncSchedule> funcs;
+
+    FuncSchedule *find(const std::string &name) {
+        for (size_t i = 0; i < funcs.size(); i++) {
+            if (funcs[i].name == name) return &funcs[i];
+        }
+        return NULL;
+    }
+
+    const FuncSchedule *find(const std::string &name) const {
+        return const_cast<Schedule *>(this)->find(name);
+    }
+
+    // One line per Func. Equal schedules give equal strings, so this
+    // doubles as the key of the evaluation cache.
+    std::string to_string() const {
+        std::ostringstream out;
+        for (size_t i = 0; i < funcs.size(); i++) {
+            const FuncSchedule &f = funcs[i];
+            out << f.name << " dims";
+            for (size_t j = 0; j < f.dims.size(); j++) out << " " << f.dims[j];
+            out << " split";
+            for (size_t j = 0; j < f.split.size(); j++) out << " " << f.split[j];
+            if (!f.halve.empty()) {
+                out << " halve";
+                for (size_t j = 0; j < f.halve.size(); j++) out << " " << f.halve[j];
+            }
+            out << " order";
+            for (size_t j = 0; j < f.order.size(); j++) out << " " << f.order[j];
+            out << " storage";
+            for (size_t j = 0; j < f.storage.size(); j++) out << " " << f.storage[j];
+            out << " vectorize " << _or_dash(f.vectorize) << " " << f.vector_width
+                << " unroll " << _or_dash(f.unroll) << " " << f.unroll_factor
+                << " parallel " << _or_dash(f.parallel) << " compute ";
+            if (f.compute == FuncSchedule::Inline) out << "inline";
+            if (f.compute == FuncSchedule::Root) out << "root";
+            if (f.compute == FuncSchedule::At) out << "at " << f.at_func << " " << f.at_var;
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    // Inverse of to_string
+    static bool from_string(const std::string &text, Schedule &s) {
+        s.funcs.clear();
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream in(line);
+            FuncSchedule f;
+            std::string word, section;
+            if (!(in >> f.name)) continue;
+            while (in >> word) {
+                if (word == "dims" || word == "split" || word == "halve" || word == "order" || word == "storage") {
+                    section = word;
+                } else if (word == "vectorize") {
+                    in >> word >> f.vector_width;
+                    f.vectorize = _from_dash(word);
+                    section = "";
+                } else if (word == "unroll") {
+                    in >> word >> f.unroll_factor;
+                    f.unroll = _from_dash(word);
+                    section = "";
+                } else if (word == "parallel") {
+                    in >> word;
+                    f.parallel = _from_dash(word);
+                    section = "";
+                } else if (word == "compute") {
+                    in >> word;
+                    if (word == "inline") f.compute = FuncSchedule::Inline;
+                    else if (word == "root") f.compute = FuncSchedule::Root;
+                    else if (word == "at") {
+                        f.compute = FuncSchedule::At;
+                        in >> f.at_func >> f.at_var;
+                    } else return false;
+                    section = "";
+                } else if (section == "dims") {
+                    f.dims.push_back(word);
+                } else if (section == "split") {
+                    f.split.push_back(atoi(word.c_str()));
+                } else if (section == "halve") {
+                    f.halve.push_back(atoi(word.c_str()));
+                } else if (section == "order") {
+                    f.order.push_back(word);
+                } else if (section == "storage") {
+                    f.storage.push_back(word);
+                } else {
+                    return false;
+                }
+            }
+            if (f.split.size() != f.dims.size()) return false;
+            s.funcs.push_back(f);
+        }
+        return true;
+    }
+
+    // The schedule as C++, in the same form as the blocks the external
+    // tuner generated, ready to paste into a test case whose output Func
+    // is called output.
+    std::string to_cpp(const std::string &output) const {
+        // Name the inner variables _x0, _y1, ... like the tuner did
+        std::map<std::string, std::string> var_names;  // "func.var" -> C++ name
+        std::vector<std::string> decls;
+        for (size_t i = 0; i < funcs.size(); i++) {
+            const FuncSchedule &f = funcs[i];
+            for (size_t j = 0; j < f.dims.size(); j++) {
+                if (f.split[j] <= 1) continue;
+                std::ostringstream name;
+                name << "_" << f.dims[j] << decls.size();
+                decls.push_back(name.str());
+                var_names[f.name + "." + FuncSchedule::inner(f.dims[j])] = name.str();
+            }
+        }
+
+        std::ostringstream out;
+        out << "    {\n"
+            << "        std::map<std::string, Halide::Internal::Function> funcs = "
+            << "Halide::Internal::find_transitive_calls((" << output << ").function());\n\n";
+        if (!decls.empty()) {
+            out << "        Halide::Var ";
+            for (size_t i = 0; i < decls.size(); i++) out << (i ? ", " : "") << decls[i];
+            out << ";\n";
+        }
+        for (size_t i = 0; i < funcs.size(); i++) {
+            const FuncSchedule &f = funcs[i];
+            if (f.compute == FuncSchedule::Inline) continue;
+            out << "        Halide::Func(funcs[\"" << f.name << "\"])\n";
+            for (size_t j = 0; j < f.dims.size(); j++) {
+                if (f.split[j] <= 1) continue;
+                out << "        .split(" << f.dims[j] << ", " << f.dims[j] << ", "
+                    << _var_name(var_names, f.name, FuncSchedule::inner(f.dims[j])) << ", " << f.split[j] << ")\n";
+            }
+            if (f.order != f.default_order()) {
+                out << "        .reorder(";
+                for (size_t j = 0; j < f.order.size(); j++) out << (j ? ", " : "") << _var_name(var_names, f.name, f.order[j]);
+                out << ")\n";
+            }
+            if (f.storage != f.dims) {
+                out << "        .reorder_storage(";
+                for (size_t j = 0; j < f.storage.size(); j++) out << (j ? ", " : "") << f.storage[j];
+                out << ")\n";
+            }
+            if (!f.vectorize.empty()) {
+                out << "        .vectorize(" << _var_name(var_names, f.name, f.vectorize);
+                if (f.vector_width) out << ", " << f.vector_width;
+                out << ")\n";
+            }
+            if (!f.unroll.empty()) {
+                out << "        .unroll(" << _var_name(var_names, f.name, f.unroll);
+                if (f.unroll_factor) out << ", " << f.unroll_factor;
+                out << ")\n";
+            }
+            if (!f.parallel.empty()) {
+                out << "        .parallel(" << _var_name(var_names, f.name, f.parallel) << ")\n";
+            }
+            if (f.compute == FuncSchedule::Root) {
+                out << "        .compute_root()\n";
+            } else {
+                out << "        .compute_at(Halide::Func(funcs[\"" << f.at_func << "\"]), "
+                    << _var_name(var_names, f.at_func, f.at_var) << ")\n";
+            }
+            out << "        ;\n";
+        }
+        out << "\n        _autotune_timing_stub(" << output << ");\n"
+            << "    };\n";
+        return out.str();
+    }
+};
+
+// Bring s in line with the pipeline: one entry per Func in pipeline
+// order, complete loop and storage orders, and only references to loop
+// variables and Funcs that exist. Invalid placements fall back to
+// compute_root; the output is always compute_root, and reductions are
+// never inlined. The result can still be rejected by Halide, but not
+// for being malformed.
+inline void conform(Schedule &s, const PipelineInfo &info) {
+    Schedule result;
+    for (size_t i = 0; i < info.funcs.size(); i++) {
+        const FuncInfo &fi = info.funcs[i];
+        const FuncSchedule *old = s.find(fi.name);
+        FuncSchedule f;
+        if (old) f = *old;
+        f.name = fi.name;
+
+        // Splits, carried over by dimension name
+        std::vector<int> split(fi.dims.size(), 1);
+        for (size_t j = 0; j < fi.dims.size(); j++) {
+            for (size_t k = 0; old && k < old->dims.size() && k < old->split.size(); k++) {
+                if (old->dims[k] == fi.dims[j]) split[j] = old->split[k];
+            }
+            if (split[j] > info.limit(fi.dims[j])) split[j] = 1;
+            if (split[j] < 1) split[j] = 1;
+        }
+        std::vector<int> halve;
+        if (fi.family) {
+            halve.resize(fi.dims.size(), 0);
+            for (size_t j = 0; j < fi.dims.size(); j++) {
+                for (size_t k = 0; old && k < old->dims.size() && k < old->halve.size(); k++) {
+                    if (old->dims[k] == fi.dims[j]) halve[j] = old->halve[k] ? 1 : 0;
+                }
+            }
+        }
+        f.dims = fi.dims;
+        f.split = split;
+        f.halve = halve;
+
+        // Loop order: keep what is valid, put missing variables back
+        // where Halide would have created them
+        std::vector<std::string> vars = f.default_order(), order;
+        for (size_t j = 0; j < f.order.size(); j++) {
+            if (std::find(vars.begin(), vars.end(), f.order[j]) != vars.end() &&
+                std::find(order.begin(), order.end(), f.order[j]) == order.end()) {
+                order.push_back(f.order[j]);
+            }
+        }
+        for (size_t j = 0; j < vars.size(); j++) {
+            if (std::find(order.begin(), order.end(), vars[j]) != order.end()) continue;
+            // Insert next to the variable it was split from, if present
+            std::string partner = f.dim_of(vars[j]);
+            bool is_inner = partner != vars[j];
+            std::vector<std::string>::iterator pos = std::find(order.begin(), order.end(), is_inner ? partner : FuncSchedule::inner(partner));
+            if (pos == order.end()) order.push_back(vars[j]);
+            else if (is_inner) order.insert(pos, vars[j]);
+            else order.insert(pos + 1, vars[j]);
+        }
+        f.order = order;
+
+        std::vector<std::string> storage;
+        for (size_t j = 0; j < f.storage.size(); j++) {
+            if (std::find(fi.dims.begin(), fi.dims.end(), f.storage[j]) != fi.dims.end() &&
+                std::find(storage.begin(), storage.end(), f.storage[j]) == storage.end()) {
+                storage.push_back(f.storage[j]);
+            }
+        }
+        for (size_t j = 0; j < fi.dims.size(); j++) {
+            if (std::find(storage.begin(), storage.end(), fi.dims[j]) == storage.end()) {
+                storage.push_back(fi.dims[j]);
+            }
+        }
+        f.storage = storage;
+
+        // Vectorizing or unrolling a dimension of small extent by more
+        // than its limit reads out of bounds, just like splitting it
+        if (!f.has_var(f.vectorize) ||
+            (f.vector_width > info.limit(f.dim_of(f.vectorize))) ||
+            (f.vector_width == 0 && f.vectorize == f.dim_of(f.vectorize))) {
+            f.vectorize = "";
+            f.vector_width = 0;
+        }
+        if (!f.has_var(f.unroll) || f.unroll_factor > info.limit(f.dim_of(f.unroll))) {
+            f.unroll = "";
+            f.unroll_factor = 0;
+        }
+        if (!f.has_var(f.parallel)) f.parallel = "";
+
+        if (fi.name == info.output) f.compute = FuncSchedule::Root;
+        if (fi.reduction && f.compute == FuncSchedule::Inline) f.compute = FuncSchedule::Root;
+        result.funcs.push_back(f);
+    }
+
+    // Placements, now that every Func's loops are known
+    for (size_t i = 0; i < result.funcs.size(); i++) {
+        FuncSchedule &f = result.funcs[i];
+        if (f.compute != FuncSchedule::At) {
+            f.at_func = f.at_var = "";
+            continue;
+        }
+        std::vector<std::string> targets = info.compute_targets(*info.find(f.name));
+        const FuncSchedule *target = result.find(f.at_func);
+        if (std::find(targets.begin(), targets.end(), f.at_func) == targets.end() ||
+            !target || target->compute == FuncSchedule::Inline) {
+            f.compute = FuncSchedule::Root;
+            f.at_func = f.at_var = "";
+        } else if (!target->has_var(f.at_var)) {
+            // Nearest surviving loop: the outer loop of the same dimension
+            std::string dim = f.at_var.size() > 1 ? f.at_var.substr(0, f.at_var.size() - 1) : f.at_var;
+            f.at_var = target->has_var(dim) ? dim : target->order.back();
+        }
+    }
+    s = result;
+}
+
+// Split a directive's argument list at top-level commas
+inline std::vector<std::string> _split_args(const std::string &args) {
+    std::vector<std::string> result;
+    int depth = 0;
+    std::string cur;
+    for (size_t i = 0; i < args.size(); i++) {
+        char ch = args[i];
+        if (ch == '(') depth++;
+        if (ch == ')') depth--;
+        if (ch == ',' && depth == 0) {
+            result.push_back(cur);
+            cur.clear();
+        } else if (ch != ' ' && ch != '\t' && ch != '\n') {
+            cur += ch;
+        }
+    }
+    if (!cur.empty()) result.push_back(cur);
+    return result;
+}
+
+// The name of the Func in "Halide::Func(funcs["name"])" or a bare name
+inline std::string _func_name(const std::string &expr) {
+    size_t q = expr.find('"');
+    if (q == std::string::npos) return expr;
+    size_t end = expr.find('"', q + 1);
+    return expr.substr(q + 1, end - q - 1);
+}
+
+inline std::string _strip_comments(const std::string &src) {
+    std::string out;
+    for (size_t i = 0; i < src.size(); i++) {
+        if (src.compare(i, 2, "//") == 0) {
+            while (i < src.size() && src[i] != '\n') i++;
+            out += '\n';
+        } else if (src.compare(i, 2, "/*") == 0) {
+            size_t end = src.find("*/", i + 2);
+            i = end == std::string::npos ? src.size() : end + 1;
+        } else {
+            out += src[i];
+        }
+    }
+    return out;
+}
+
+// Read the generated schedule out of a test case: the statements between
+// its "Halide::Var _..." declaration and the call to
+// _autotune_timing_stub. Both the funcs["name"] form and the older bare
+// form ("clamped .split(...)") are understood. Directives outside the
+// vocabulary, and extra vectorize/unroll/parallel calls on the same Func,
+// are dropped. Call conform() on the result before using it.
+inline bool parse_generated(const std::string &source, Schedule &s) {
+    std::string src = _strip_comments(source);
+    size_t begin = src.find("Halide::Var _");
+    size_t end = src.find("_autotune_timing_stub(", begin == std::string::npos ? 0 : begin);
+    if (begin == std::string::npos || end == std::string::npos) return false;
+    begin = src.find(';', begin);
+    std::string block = src.substr(begin + 1, end - begin - 1);
+
+    struct Directive { std::string func, op; std::vector<std::string> args; };
+    std::vector<Directive> directives;
+    std::istringstream statements(block);
+    std::string stmt;
+    while (std::getline(statements, stmt, ';')) {
+        size_t pos = stmt.find_first_not_of(" \t\n{}");
+        if (pos == std::string::npos) continue;
+        // The Func is everything up to the first top-level '.'
+        size_t dot = pos;
+        int depth = 0;
+        for (; dot < stmt.size(); dot++) {
+            if (stmt[dot] == '(') depth++;
+            if (stmt[dot] == ')') depth--;
+            if (stmt[dot] == '.' && depth == 0) break;
+        }
+        std::string func = stmt.substr(pos, dot - pos);
+        func.erase(func.find_last_not_of(" \t\n") + 1);
+        func = _func_name(func);
+
+        while (dot < stmt.size()) {
+            size_t open = stmt.find('(', dot);
+            if (open == std::string::npos) break;
+            Directive d;
+            d.func = func;
+            d.op = stmt.substr(dot + 1, open - dot - 1);
+            d.op.erase(d.op.find_last_not_of(" \t\n") + 1);
+            d.op.erase(0, d.op.find_first_not_of(" \t\n"));
+            size_t close = open;
+            depth = 0;
+            for (; close < stmt.size(); close++) {
+                if (stmt[close] == '(') depth++;
+                if (stmt[close] == ')' && --depth == 0) break;
+            }
+            d.args = _split_args(stmt.substr(open + 1, close - open - 1));
+            directives.push_back(d);
+            dot = stmt.find('.', close);
+            if (dot == std::string::npos) break;
+        }
+    }
+
+    // Tuner variables are globally unique, so map each to its Func's
+    // inner variable first, then interpret the directives
+    std::map<std::string, std::string> inner;
+    s.funcs.clear();
+    for (size_t i = 0; i < directives.size(); i++) {
+        const Directive &d = directives[i];
+        if (d.op == "split" && d.args.size() == 4 && d.args[0] == d.args[1]) {
+            inner[d.args[2]] = FuncSchedule::inner(d.args[0]);
+        }
+        if (!s.find(d.func)) {
+            FuncSchedule f;
+            f.name = d.func;
+            s.funcs.push_back(f);
+        }
+    }
+    for (size_t i = 0; i < directives.size(); i++) {
+        const Directive &d = directives[i];
+        FuncSchedule &f = *s.find(d.func);
+        std::vector<std::string> args = d.args;
+        for (size_t j = 0; j < args.size(); j++) {
+            if (inner.count(args[j])) args[j] = inner[args[j]];
+        }
+        if (d.op == "split" && args.size() == 4 && args[0] == args[1] &&
+            args[2] == FuncSchedule::inner(args[0])) {
+            f.dims.push_back(args[0]);
+            f.split.push_back(atoi(args[3].c_str()));
+        } else if (d.op == "reorder") {
+            f.order = args;
+        } else if (d.op == "reorder_storage") {
+            f.storage = args;
+        } else if (d.op == "vectorize" && !args.empty() && f.vectorize.empty()) {
+            f.vectorize = args[0];
+            f.vector_width = args.size() > 1 ? atoi(args[1].c_str()) : 0;
+        } else if (d.op == "unroll" && !args.empty() && f.unroll.empty()) {
+            f.unroll = args[0];
+            f.unroll_factor = args.size() > 1 ? atoi(args[1].c_str()) : 0;
+        } else if (d.op == "parallel" && !args.empty() && f.parallel.empty()) {
+            f.parallel = args[0];
+        } else if (d.op == "compute_root") {
+            f.compute = FuncSchedule::Root;
+        } else if (d.op == "compute_at" && args.size() == 2) {
+            f.compute = FuncSchedule::At;
+            f.at_func = _func_name(args[0]);
+            f.at_var = args[1];
+        }
+    }
+    return true;
+}
+
+// Read a schedule from a file written with to_string (tune -w), or from
+// the generated block of a test case
+inline bool load_schedule(const std::string &path, Schedule &s) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    if (Schedule::from_string(text, s) && !s.funcs.empty()) return true;
+    return parse_generated(text, s);
+}
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef SEARCH_TEMPLATE_H
+#define SEARCH_TEMPLATE_H
+
+// Level-parametric schedules for pyramids. A template has one
+// FuncSchedule per stage ("downsampled", "upsampledx", ...) in place of
+// one per level. It is an ordinary Schedule over the reduced pipeline
+// that template_info describes, so the search runs on it unchanged.
+// expand() turns a template into the schedule of a pyramid of any depth:
+//
+//  - the Func at level l gets its stage's schedule;
+//  - a split marked in halve is divided by 2^l, like the 32 >> l tiles
+//    of the hand-written GPU schedule (but never below 1);
+//  - compute_at a stage means compute_at that stage's Func which
+//    consumes this one.
+//
+// The number of genes no longer grows with depth, and a template tuned
+// on a shallow pyramid applies to a deeper one.
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "schedule.h"
+
+namespace search {
+
+// The stage and level of the Func called name, if it belongs to one
+inline bool stage_of(const PipelineInfo &info, const std::string &name, std::string &stage, int &level) {
+    typedef std::map<std::string, std::vector<std::string> > Stages;
+    for (Stages::const_iterator it = info.stages.begin(); it != info.stages.end(); ++it) {
+        std::vector<std::string>::const_iterator pos = std::find(it->second.begin(), it->second.end(), name);
+        if (pos != it->second.end()) {
+            stage = it->first;
+            level = (int)(pos - it->second.begin());
+            return true;
+        }
+    }
+    return false;
+}
+
+// The name a Func goes by in templates: its stage, or its own name
+inline std::string template_name(const PipelineInfo &info, const std::string &name) {
+    std::string stage;
+    int level;
+    return stage_of(info, name, stage, level) ? stage : name;
+}
+
+// The pipeline as templates see it: every stage folded into one Func
+// with the union of its instances' consumers (so it may only be computed
+// at a consumer if all its instances are consumed by the same stage)
+inline PipelineInfo template_info(const PipelineInfo &full) {
+    PipelineInfo t;
+    t.output = full.output;
+    t.dim_limit = full.dim_limit;
+    t.stages = full.stages;
+    for (size_t i = 0; i < full.funcs.size(); i++) {
+        const FuncInfo &f = full.funcs[i];
+        std::string name = f.name;
+        int level;
+        bool family = stage_of(full, f.name, name, level);
+        FuncInfo *tf = NULL;
+        for (size_t j = 0; j < t.funcs.size(); j++) {
+            if (t.funcs[j].name == name) tf = &t.funcs[j];
+        }
+        if (!tf) {
+            FuncInfo n;
+            n.name = name;
+            n.dims = f.dims;
+            n.family = family;
+            t.funcs.push_back(n);
+            tf = &t.funcs.back();
+        }
+        tf->reduction = tf->reduction || f.reduction;
+        for (size_t j = 0; j < f.consumers.size(); j++) {
+            std::string c = template_name(full, f.consumers[j]);
+            if (c != name && std::find(tf->consumers.begin(), tf->consumers.end(), c) == tf->consumers.end()) {
+                tf->consumers.push_back(c);
+            }
+        }
+    }
+    return t;
+}
+
+// The schedule template t stands for in the full pipeline
+inline Schedule expand(const Schedule &t, const PipelineInfo &full) {
+    Schedule s;
+    for (size_t i = 0; i < full.funcs.size(); i++) {
+        const FuncInfo &fi = full.funcs[i];
+        std::string stage;
+        int level = 0;
+        bool family = stage_of(full, fi.name, stage, level);
+        const FuncSchedule *src = t.find(family ? stage : fi.name);
+        if (!src) continue;
+
+        FuncSchedule f = *src;
+        f.name = fi.name;
+        for (size_t d = 0; d < f.halve.size() && d < f.split.size(); d++) {
+            if (f.halve[d]) f.split[d] = std::max(1, f.split[d] >> level);
+        }
+        f.halve.clear();
+
+        // compute_at a stage: this Func's consumer in that stage
+        if (f.compute == FuncSchedule::At && full.stages.count(f.at_func) && fi.consumers.size() == 1 &&
+            template_name(full, fi.consumers[0]) == f.at_func) {
+            f.at_func = fi.consumers[0];
+        }
+        s.funcs.push_back(f);
+    }
+    conform(s, full);
+    return s;
+}
+
+// A template from a full schedule, taking each stage's schedule from its
+// finest level. Used to seed a template search with existing schedules.
+inline Schedule collapse(const Schedule &s, const PipelineInfo &full) {
+    PipelineInfo tinfo = template_info(full);
+    Schedule t;
+    for (size_t i = 0; i < tinfo.funcs.size(); i++) {
+        const FuncInfo &tf = tinfo.funcs[i];
+        const FuncSchedule *src = NULL;
+        if (tf.family) {
+            const std::vector<std::string> &names = full.stages.find(tf.name)->second;
+            for (size_t l = 0; l < names.size() && !src; l++) src = s.find(names[l]);
+        } else {
+            src = s.find(tf.name);
+        }
+        if (!src) continue;
+        FuncSchedule f = *src;
+        f.name = tf.name;
+        if (f.compute == FuncSchedule::At) f.at_func = template_name(full, f.at_func);
+        t.funcs.push_back(f);
+    }
+    conform(t, tinfo);
+    return t;
+}
+
+}
+
+#endif
@@ -0,0 +1,260 @@
+// Search for a schedule for one of the pipelines, in process.
+//
+//   search/tune [-p pipeline] [-l levels] [-g generations] [-n population]
+//               [-s seed] [-e eta] [-t trials] [-N size] [-T timeout]
+//               [-M megabytes] [-C checkpoint] [-L] [-w template.txt]
+//               [-P] [-B megabytes] [-F front.txt] [-O configs] [-o best.cpp]
+//               [seed ...]
+//
+// The population starts from the given schedules (test cases, or files
+// written by -w; see load_schedule), an all-root schedule and random
+// ones. Each generation's new candidates are raced by successive halving
+// with factor eta (search/halving.h); -e 0 instead measures each one
+// with progressive_measure and the given number of trials. Each
+// generation prints one JSON line; the best schedule is written as a
+// block in the format of the generated test cases.
+//
+// With -C, the search state is saved to the checkpoint file after every
+// generation, and a search started with an existing checkpoint resumes
+// from it (seed cases are then ignored). -g is the total number of
+// generations, counting those already done. A checkpoint only resumes
+// under the options it was saved with: -p, -l, -L, -P, -O, -N, -t, -T,
+// -M, -B and -n.
+//
+// With -L, the search is over level-parametric templates
+// (search/template.h): one schedule per pyramid stage, expanded to the
+// requested depth for every evaluation. -w writes the best template,
+// which search/template.h can expand for any other depth.
+//
+// With -P, selection is on time and peak memory together (Pareto ranks,
+// search/evolve.h) instead of time alone. Either way, the Pareto front of
+// everything evaluated is printed at the end and -F writes it (see
+// search/pareto.h). -B picks the fastest schedule within that many
+// megabytes as "the best" one for -w and -o.
+//
+// With -O, the objective is the weighted geometric mean of the times
+// under a list of sizes and thread counts (harness/configs.h), e.g.
+// -O "512x512x3@4,16;2048x2048x3@4,16;4096x4096x3@4,16", in place of the
+// single size -N. Each candidate is compiled once and measured with -t
+// trials under every configuration; there is no racing or pruning, since
+// a schedule that loses at one size may win at another. Peak memory is
+// the largest of any configuration. The best schedule's result under
+// each configuration is printed at the end.
+
+#include <Halide.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "search/apply.h"
+#include "search/checkpoint.h"
+#include "search/evaluate.h"
+#include "search/evolve.h"
+#include "search/halving.h"
+#include "search/pareto.h"
+#include "search/schedule.h"
+#include "search/template.h"
+
+using namespace search;
+
+static void usage() {
+    fprintf(stderr, "usage: tune [-p pipeline] [-l levels] [-g generations] [-n population] [-s seed] [-e eta]\n"
+                    "            [-t trials] [-N size] [-T timeout] [-M megabytes] [-C checkpoint] [-L]\n"
+                    "            [-w template.txt] [-P] [-B megabytes] [-F front.txt] [-O configs] [-o best.cpp]\n"
+                    "            [seed ...]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    EvalOptions options;
+    HalvingOptions halving;
+    options.pipeline = "interpolate";
+    int generations = 20, population = 32;
+    unsigned int seed = 0;
+    const char *size = NULL, *output = NULL, *checkpoint = NULL, *template_output = NULL;
+    const char *front_output = NULL, *objective = "";
+    bool templates = false, pareto = false;
+    size_t budget = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:g:n:s:e:t:N:T:M:C:Lw:PB:F:O:o:v")) != -1) {
+        switch (opt) {
+        case 'p': options.pipeline = optarg; break;
+        case 'l': options.levels = atoi(optarg); break;
+        case 'g': generations = atoi(optarg); break;
+        case 'n': population = atoi(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        case 'e': halving.eta = atoi(optarg); break;
+        case 't': options.trials = atoi(optarg); break;
+        case 'N': size = optarg; break;
+        case 'T': options.timeout = atof(optarg); break;
+        case 'M': options.memory_limit = (size_t)atol(optarg) << 20; break;
+        case 'C': checkpoint = optarg; break;
+        case 'L': templates = true; break;
+        case 'w': template_output = optarg; break;
+        case 'P': pareto = true; break;
+        case 'B': budget = (size_t)atol(optarg) << 20; break;
+        case 'F': front_output = optarg; break;
+        case 'O': objective = optarg; break;
+        case 'o': output = optarg; break;
+        case 'v': options.quiet = false; break;
+        default: usage();
+        }
+    }
+
+    pipelines::Pipeline p = pipelines::make_pipeline(options.pipeline, options.levels);
+    if (p.funcs.empty()) {
+        fprintf(stderr, "unknown pipeline %s\n", options.pipeline.c_str());
+        return 2;
+    }
+    options.size = size ? autotune::parse_size(size) : p.size;
+    if (options.size.empty() || options.size.size() > 4 || options.trials < 1) {
+        fprintf(stderr, "-N takes 1 to 4 extents and -t at least one trial\n");
+        return 2;
+    }
+    options.configs = autotune::parse_configs(objective);
+    if (*objective && options.configs.empty()) {
+        fprintf(stderr, "no configurations in %s\n", objective);
+        return 2;
+    }
+    PipelineInfo info = describe(p);
+    if (templates && info.stages.empty()) {
+        fprintf(stderr, "%s has no per-level stages to template\n", options.pipeline.c_str());
+        return 2;
+    }
+    // What the search works on, and how that becomes a schedule
+    PipelineInfo genome = templates ? template_info(info) : info;
+    auto schedule_of = [&](const Schedule &s) { return templates ? expand(s, info) : s; };
+
+    std::vector<Schedule> seeds;
+    for (int i = optind; i < argc; i++) {
+        Schedule s;
+        if (!load_schedule(argv[i], s)) {
+            fprintf(stderr, "no schedule in %s\n", argv[i]);
+            continue;
+        }
+        bool is_template = true;
+        for (size_t j = 0; j < s.funcs.size(); j++) is_template = is_template && genome.find(s.funcs[j].name);
+        seeds.push_back(templates && !is_template ? collapse(s, info) : s);
+    }
+
+    Evolution evolution(genome, population, seed);
+    evolution.pareto = pareto;
+    size_t realizations = 0;
+    Evolution::Evaluator eval = [&](const std::vector<Schedule> &genes) {
+        std::vector<Schedule> batch;
+        for (size_t i = 0; i < genes.size(); i++) batch.push_back(schedule_of(genes[i]));
+        std::vector<Evaluation> results;
+        if (!options.configs.empty()) {
+            for (size_t i = 0; i < batch.size(); i++) results.push_back(evaluate_configs(batch[i], options));
+        } else if (halving.eta > 0) {
+            results = successive_halving(batch, options, halving);
+        } else {
+            double incumbent = evolution.population.empty() || !evolution.best().eval.ok ? 0 : evolution.best().eval.time;
+            for (size_t i = 0; i < batch.size(); i++) {
+                results.push_back(evaluate_forked(batch[i], options, incumbent));
+                const Evaluation &e = results.back();
+                if (e.ok && !e.pruned && (incumbent == 0 || e.time < incumbent)) incumbent = e.time;
+            }
+        }
+        for (size_t i = 0; i < results.size(); i++) realizations += results[i].realizations;
+        return results;
+    };
+
+    // What a checkpoint must have been saved under to be resumed: the
+    // cached evaluations are only comparable with new ones measured the
+    // same way, and ranked the same way
+    std::map<std::string, std::string> setup;
+    setup["pipeline"] = options.pipeline;
+    setup["levels"] = std::to_string(options.levels);
+    setup["templates"] = templates ? "1" : "0";
+    setup["pareto"] = pareto ? "1" : "0";
+    setup["objective"] = objective;
+    for (size_t i = 0; i < options.size.size(); i++) setup["size"] += (i ? "x" : "") + std::to_string(options.size[i]);
+    setup["trials"] = std::to_string(options.trials);
+    setup["timeout"] = std::to_string(options.timeout);
+    setup["memory_limit"] = std::to_string(options.memory_limit);
+    setup["budget"] = std::to_string(budget);
+
+    std::map<std::string, std::string> meta;
+    bool resumed = false;
+    if (checkpoint && load_checkpoint(checkpoint, evolution, meta)) {
+        for (std::map<std::string, std::string>::iterator i = setup.begin(); i != setup.end(); ++i) {
+            if (meta[i->first] != i->second) {
+                fprintf(stderr, "%s is a checkpoint of a different search (%s %s, not %s)\n", checkpoint,
+                        i->first.c_str(), meta[i->first].c_str(), i->second.c_str());
+                return 2;
+            }
+        }
+        if (evolution.population.size() != (size_t)population) {
+            fprintf(stderr, "%s is a checkpoint of a different search (population %zu, not %d)\n", checkpoint,
+                    evolution.population.size(), population);
+            return 2;
+        }
+        realizations = strtoull(meta["realizations"].c_str(), NULL, 10);
+        resumed = true;
+        fprintf(stderr, "resuming %s after generation %d\n", checkpoint, evolution.generation);
+    }
+
+    for (int g = resumed ? evolution.generation + 1 : 0; g <= generations; g++) {
+        if (g == 0) evolution.start(seeds, eval);
+        else evolution.step(eval);
+        if (checkpoint) {
+            for (std::map<std::string, std::string>::iterator i = setup.begin(); i != setup.end(); ++i) {
+                meta[i->first] = i->second;
+            }
+            meta["realizations"] = std::to_string(realizations);
+            if (!save_checkpoint(checkpoint, evolution, meta)) perror(checkpoint);
+        }
+        const Individual &best = evolution.best();
+        printf("{\"generation\": %d, \"best\": %.10f, \"best_ok\": %d, \"peak_mem\": %zu, "
+               "\"failed\": %zu, \"evaluated\": %zu, \"cache_hits\": %zu, \"realizations\": %zu}\n",
+               evolution.generation, best.eval.time, best.eval.ok ? 1 : 0, best.eval.peak_mem,
+               evolution.failed(), evolution.evaluated, evolution.cache_hits, realizations);
+        fflush(stdout);
+    }
+
+    std::vector<FrontEntry> front = pareto_front(evolution.cache);
+    for (size_t i = 0; i < front.size(); i++) {
+        printf("{\"front\": %zu, \"time\": %.10f, \"peak_mem\": %zu}\n", i, front[i].eval.time, front[i].eval.peak_mem);
+    }
+    if (front_output && !save_front(front_output, front)) perror(front_output);
+
+    Schedule best = evolution.best().schedule;
+    if (budget) {
+        const FrontEntry *pick = fastest_within(front, budget);
+        if (!pick) {
+            fprintf(stderr, "nothing found within %zu MB\n", budget >> 20);
+            return 1;
+        }
+        best = pick->schedule;
+    }
+    if (!options.configs.empty()) {
+        std::vector<autotune::ConfigResult> per_config;
+        evaluate_configs(schedule_of(best), options, &per_config);
+        if (!per_config.empty()) autotune::print_config_results(options.configs, per_config);
+    }
+    if (template_output && templates) {
+        std::ofstream out(template_output);
+        out << best.to_string();
+        if (!out) perror(template_output);
+    }
+    std::string cpp = schedule_of(best).to_cpp(p.output.name());
+    if (output) {
+        FILE *f = fopen(output, "w");
+        if (!f) {
+            perror(output);
+            return 1;
+        }
+        fprintf(f, "%s", cpp.c_str());
+        fclose(f);
+    } else {
+        printf("%s", cpp.c_str());
+    }
+    return 0;
+}
@@ -5,6 +5,15 @@
 
 #include <map>
 #include <string>
+#include <vector>
+
+#include "harness/batch.h"
+#include "harness/configs.h"
+#include "harness/harness.h"
+#include "harness/images.h"
+#include "harness/pool.h"
+#include "harness/progressive.h"
+#include "harness/trace.h"
 
 // How many times to run (and take min)
 // #define AUTOTUNE_TRIALS 3
@@ -15,23 +24,157 @@
 // Size to run with
 // #define AUTOTUNE_N 1024, 1024
 
+// Stay alive after compiling and time one realization per "run" line on
+// stdin, instead of timing AUTOTUNE_TRIALS runs and exiting. Used by
+// tools/ab_compare to interleave two builds of the same schedule.
+// #define AUTOTUNE_SERVE
+
+// Time the candidate at 256x256 first, then at doubling sizes up to
+// AUTOTUNE_N, and stop early once its extrapolated time exceeds
+// AUTOTUNE_INCUMBENT (seconds, the best time so far) by more than a
+// factor of AUTOTUNE_PROGRESSIVE_SLACK.
+// #define AUTOTUNE_PROGRESSIVE
+// #define AUTOTUNE_INCUMBENT 0.25
+// Time every configuration of a list in harness/configs.h format (sizes
+// and thread counts, e.g. "512x512x3@4,16;2048x2048x3@4,16") instead of
+// AUTOTUNE_N alone: one line per configuration, then their weighted
+// geometric mean as "time".
+// #define AUTOTUNE_CONFIGS "512x512x3@4,16;2048x2048x3@4,16;4096x4096x3@4,16"
+
+// How the output and inputs are set up for timed runs, AUTOTUNE_SERVE and
+// AUTOTUNE_FRAMES. With AUTOTUNE_INFER_OUTPUT the output is allocated at
+// the region a bounds query on AUTOTUNE_N returns (harness.h,
+// bind_inferred) rather than at AUTOTUNE_N from 0; with AUTOTUNE_FILL 0
+// the inputs are left as allocated rather than filled with the
+// generated pattern. The old schedule files set them as their own stubs
+// behaved, so that they keep reproducing what they were written for.
+// #define AUTOTUNE_INFER_OUTPUT
+// #define AUTOTUNE_FILL 0
+
+// Realize this many frames back to back with the output and the
+// intermediates' allocations kept between frames (harness/batch.h), and
+// report the frame latency distribution and throughput instead.
+// #define AUTOTUNE_FRAMES 100
+
+// Read the input from this file, mapped without copying, instead of the
+// generated pattern (harness/images.h): a PFM file (RGB gets an opaque
+// alpha channel where the pipeline reads RGBA), or a raw planar one
+// of the extents the pipeline reads for AUTOTUNE_N. Timed runs only.
+// #define AUTOTUNE_INPUT "photo.raw"
+
+// The allocator the pipeline gets (harness/memory.h): Counting (the
+// system's, counted), Retaining or Pooled, a per-thread size-classed pool
+// for schedules that allocate inside inner loops, or Numa, which places
+// large blocks by AUTOTUNE_NUMA_POLICY (harness/numa.h): FirstTouch,
+// Interleave, or Partitioned in AUTOTUNE_NUMA_STRIPES stripes per node,
+// or HugePages, which backs blocks of AUTOTUNE_HUGE_THRESHOLD bytes and
+// more with huge pages by AUTOTUNE_HUGE_PAGES (harness/hugepages.h):
+// Transparent or HugeTLB.
+// #define AUTOTUNE_ALLOCATOR Pooled
+// #define AUTOTUNE_NUMA_POLICY Interleave
+// #define AUTOTUNE_NUMA_STRIPES 1
+// #define AUTOTUNE_HUGE_PAGES HugeTLB
+// #define AUTOTUNE_HUGE_THRESHOLD (2 << 20)
+
+// Run the pipeline's parallel loops on the work-stealing pool in
+// harness/pool.h, with one pinned worker per core (or HL_NUMTHREADS),
+// instead of the runtime's pool. Like the runtime's, it starts at the
+// first parallel loop, so AUTOTUNE_CONFIGS' thread counts apply to it.
+// #define AUTOTUNE_WORK_POOL
+
+// Record a timeline of the realizations (harness/trace.h) and write it to
+// this file as Chrome trace JSON on exit, with one in AUTOTUNE_TRACE_STORES
+// stores (0 for none). Per-thread rings of AUTOTUNE_TRACE_RING events
+// keep the latest events only. make foo.timeline builds this in.
+// #define AUTOTUNE_TRACE "foo.json"
+// #define AUTOTUNE_TRACE_STORES 0
+// #define AUTOTUNE_TRACE_RING 65536
+
+#ifndef AUTOTUNE_INCUMBENT
+#define AUTOTUNE_INCUMBENT 0
+#endif
+#ifndef AUTOTUNE_PROGRESSIVE_SLACK
+#define AUTOTUNE_PROGRESSIVE_SLACK 1.5
+#endif
+#ifndef AUTOTUNE_ALLOCATOR
+#define AUTOTUNE_ALLOCATOR Counting
+#endif
+#ifndef AUTOTUNE_NUMA_POLICY
+#define AUTOTUNE_NUMA_POLICY FirstTouch
+#endif
+#ifndef AUTOTUNE_NUMA_STRIPES
+#define AUTOTUNE_NUMA_STRIPES 1
+#endif
+#ifndef AUTOTUNE_HUGE_PAGES
+#define AUTOTUNE_HUGE_PAGES Transparent
+#endif
+#ifndef AUTOTUNE_HUGE_THRESHOLD
+#define AUTOTUNE_HUGE_THRESHOLD (2 << 20)
+#endif
+#ifndef AUTOTUNE_TRACE_STORES
+#define AUTOTUNE_TRACE_STORES 0
+#endif
+#ifndef AUTOTUNE_TRACE_RING
+#define AUTOTUNE_TRACE_RING 65536
+#endif
+#ifndef AUTOTUNE_FILL
+#define AUTOTUNE_FILL 1
+#endif
+
+inline Halide::Buffer _autotune_bind(Halide::Func& func, const std::vector<int>& n) {
+#ifdef AUTOTUNE_INFER_OUTPUT
+    return autotune::bind_inferred(func, n, 0, AUTOTUNE_FILL);
+#else
+    return autotune::bind(func, n, 0, AUTOTUNE_FILL);
+#endif
+}
+
 inline void _autotune_timing_stub(Halide::Func& func) {
-    func.compile_jit();
-    func.infer_input_bounds(AUTOTUNE_N);
-    timeval t1, t2;
-    double rv = 0;
-    const unsigned int timeout = AUTOTUNE_LIMIT;
-    alarm(timeout);
-    for (int i = 0; i < AUTOTUNE_TRIALS; i++) {
-      gettimeofday(&t1, NULL);
-      func.realize(AUTOTUNE_N);
-      gettimeofday(&t2, NULL);
-      alarm(0); // disable alarm
-      double t = (t2.tv_sec - t1.tv_sec) + (t2.tv_usec - t1.tv_usec)/1000000.0;
-      if(i == 0 || t < rv)
-        rv = t;
-    }
-    printf("{\"time\": %.10f}\n", rv);
+    const int size[] = {AUTOTUNE_N};
+    std::vector<int> n(size, size + sizeof(size) / sizeof(size[0]));
+    autotune::numa_policy() = autotune::AUTOTUNE_NUMA_POLICY;
+    autotune::numa_stripes() = AUTOTUNE_NUMA_STRIPES;
+    autotune::huge_page_mode() = autotune::AUTOTUNE_HUGE_PAGES;
+    autotune::huge_threshold() = AUTOTUNE_HUGE_THRESHOLD;
+#ifdef AUTOTUNE_WORK_POOL
+    func.set_custom_do_par_for(autotune::work_pool_do_par_for);
+#endif
+#ifdef AUTOTUNE_TRACE
+    autotune::enable_tracing(func, AUTOTUNE_TRACE_STORES, AUTOTUNE_TRACE_RING);
+#endif
+#if defined(AUTOTUNE_CONFIGS)
+    autotune::compile(func, autotune::AUTOTUNE_ALLOCATOR);
+    std::vector<autotune::Config> configs = autotune::parse_configs(AUTOTUNE_CONFIGS);
+    autotune::print_config_results(configs, autotune::measure_configs(func, configs, AUTOTUNE_TRIALS, AUTOTUNE_LIMIT));
+#elif defined(AUTOTUNE_FRAMES)
+    autotune::compile(func, autotune::Retaining);
+    std::vector<Halide::Func> funcs(1, func);
+    std::vector<Halide::Buffer> outputs(1, _autotune_bind(func, n));
+    autotune::print_batch_result(autotune::run_batch(funcs, outputs, AUTOTUNE_FRAMES, AUTOTUNE_LIMIT));
+#elif defined(AUTOTUNE_PROGRESSIVE)
+    autotune::compile(func, autotune::AUTOTUNE_ALLOCATOR);
+    autotune::print_progressive_result(
+        autotune::progressive_measure(func, n, AUTOTUNE_TRIALS, AUTOTUNE_INCUMBENT,
+                                      AUTOTUNE_PROGRESSIVE_SLACK, AUTOTUNE_LIMIT));
+#else
+    autotune::compile(func, autotune::AUTOTUNE_ALLOCATOR);
+    Halide::Buffer output = _autotune_bind(func, n);
+#ifdef AUTOTUNE_INPUT
+    autotune::MappedImage image;
+    if (!autotune::bind_file(func, AUTOTUNE_INPUT, image)) exit(1);
+#endif
+#ifdef AUTOTUNE_SERVE
+    autotune::serve(func, output, AUTOTUNE_LIMIT);
+#else
+    autotune::print_result(autotune::measure(func, output, AUTOTUNE_TRIALS, AUTOTUNE_LIMIT));
+#endif
+#endif
+#ifdef AUTOTUNE_TRACE
+    size_t recorded, dropped;
+    autotune::trace_counts(recorded, dropped);
+    if (autotune::write_trace(AUTOTUNE_TRACE) < 0) exit(1);
+    fprintf(stderr, "%s: %zu events, %zu overwritten\n", AUTOTUNE_TRACE, recorded, dropped);
+#endif
     exit(0);
 }
 
@@ -43,4 +186,3 @@ inline void _autotune_timing_stub(Halide::Func& func) {
 #ifndef BASELINE_HOOK
 #define BASELINE_HOOK(x)
 #endif
-
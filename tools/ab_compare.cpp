@@ -0,0 +1,221 @@
+// Side-by-side comparison of one schedule built against two Halide
+// versions (see the %.ab target in the Makefile).
+//
+//   ab_compare [-n rounds] [-w warmup] [-c cpus] [-t tolerance] A.exe B.exe
+//
+// Both binaries run on the same cores (-c pins this process, and both
+// children inherit the mask) with the same deterministically filled
+// inputs. Trials alternate A B B A A B ..., so thermal and frequency
+// drift hits both sides equally, and the pairs are compared with a
+// paired t-test on log(time_b / time_a).
+//
+// Binaries built with -DAUTOTUNE_SERVE stay alive and run one trial per
+// request, so compilation is paid once. Anything else that prints
+// {"time": ...} and exits (e.g. the cases in old/) is simply rerun for
+// every trial, and its memory is taken from the child's peak RSS.
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "../harness/stats.h"
+#include "json.h"
+
+using std::string;
+using std::vector;
+
+struct Child {
+    string exe;
+    pid_t pid;
+    FILE *to, *from;
+    bool serving;
+    vector<double> times, mems;
+};
+
+static void spawn(Child &c) {
+    int in[2], out[2];
+    if (pipe(in) || pipe(out)) {
+        perror("pipe");
+        exit(1);
+    }
+    c.pid = fork();
+    if (c.pid == 0) {
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+        execl(c.exe.c_str(), c.exe.c_str(), (char *)NULL);
+        perror(c.exe.c_str());
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    c.to = fdopen(in[1], "w");
+    c.from = fdopen(out[0], "r");
+}
+
+static bool read_line(Child &c, string &line) {
+    char buf[1024];
+    if (!fgets(buf, sizeof(buf), c.from)) return false;
+    line = buf;
+    return true;
+}
+
+// Reap a one-shot child and return its peak RSS in bytes
+static double reap(Child &c) {
+    int status = 0;
+    rusage ru;
+    fclose(c.to);
+    fclose(c.from);
+    wait4(c.pid, &status, 0, &ru);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s failed (status %d)\n", c.exe.c_str(), status);
+        exit(1);
+    }
+    return (double)ru.ru_maxrss * 1024;
+}
+
+// Start c and work out which protocol it speaks
+static void start(Child &c) {
+    spawn(c);
+    string line;
+    if (!read_line(c, line)) {
+        fprintf(stderr, "%s exited without output\n", c.exe.c_str());
+        exit(1);
+    }
+    c.serving = line.find("\"ready\"") != string::npos;
+    if (!c.serving) reap(c); // the first one-shot run doubles as warmup
+}
+
+static void trial(Child &c, bool record) {
+    string line;
+    double mem;
+    if (c.serving) {
+        fprintf(c.to, "run\n");
+        fflush(c.to);
+        if (!read_line(c, line)) {
+            fprintf(stderr, "%s died during a trial\n", c.exe.c_str());
+            exit(1);
+        }
+        mem = json_number(line, "peak_mem", 0);
+    } else {
+        spawn(c);
+        if (!read_line(c, line)) line = "";
+        mem = reap(c);
+    }
+    double t = json_number(line, "time", -1);
+    if (t < 0) {
+        fprintf(stderr, "%s: no time in \"%s\"\n", c.exe.c_str(), line.c_str());
+        exit(1);
+    }
+    if (record) {
+        c.times.push_back(t);
+        c.mems.push_back(mem);
+    }
+}
+
+static void stop(Child &c) {
+    if (!c.serving) return;
+    fprintf(c.to, "quit\n");
+    fflush(c.to);
+    fclose(c.to);
+    fclose(c.from);
+    waitpid(c.pid, NULL, 0);
+}
+
+// Parse a cpu list like "0-3,8,10-11"
+static bool parse_cpus(const char *s, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*s) {
+        char *end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s) return false;
+        if (*end == '-') {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s) return false;
+        }
+        for (long i = lo; i <= hi; i++) CPU_SET(i, set);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: ab_compare [-n rounds] [-w warmup] [-c cpus] [-t tolerance] A.exe B.exe\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int rounds = 20, warmup = 2;
+    double tolerance = 0.02;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:w:c:t:")) != -1) {
+        switch (opt) {
+        case 'n': rounds = atoi(optarg); break;
+        case 'w': warmup = atoi(optarg); break;
+        case 't': tolerance = atof(optarg); break;
+        case 'c': {
+            cpu_set_t set;
+            if (!parse_cpus(optarg, &set)) usage();
+            if (sched_setaffinity(0, sizeof(set), &set)) {
+                perror("sched_setaffinity");
+                return 1;
+            }
+            break;
+        }
+        default: usage();
+        }
+    }
+    if (argc - optind != 2 || rounds < 2) usage();
+    signal(SIGPIPE, SIG_IGN);
+
+    Child a, b;
+    a.exe = argv[optind];
+    b.exe = argv[optind + 1];
+    start(a);
+    start(b);
+
+    for (int i = 0; i < warmup + rounds; i++) {
+        bool record = i >= warmup;
+        if (i % 2 == 0) {
+            trial(a, record);
+            trial(b, record);
+        } else {
+            trial(b, record);
+            trial(a, record);
+        }
+    }
+    stop(a);
+    stop(b);
+
+    autotune::RatioEstimate time = autotune::paired_ratio(a.times, b.times);
+    double mem_a = autotune::median(a.mems), mem_b = autotune::median(b.mems);
+    double mem_ratio = mem_a > 0 ? mem_b / mem_a : 1;
+
+    const char *verdict = "inconclusive";
+    if (time.lo > 1 + tolerance || mem_ratio > 1 + tolerance) {
+        verdict = "regression";
+    } else if (time.hi <= 1 + tolerance) {
+        verdict = "safe";
+    }
+
+    printf("{\"a\": {\"time\": %.10f, \"peak_mem\": %.0f}, "
+           "\"b\": {\"time\": %.10f, \"peak_mem\": %.0f}, "
+           "\"time_ratio\": %.6f, \"time_ratio_ci95\": [%.6f, %.6f], "
+           "\"confidence\": %.6f, \"mem_ratio\": %.6f, \"rounds\": %d, "
+           "\"verdict\": \"%s\"}\n",
+           autotune::median(a.times), mem_a,
+           autotune::median(b.times), mem_b,
+           time.ratio, time.lo, time.hi,
+           1 - time.p_value, mem_ratio, time.n, verdict);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef AUTOTUNE_TOOLS_JSON_H
+#define AUTOTUNE_TOOLS_JSON_H
+
+// Just enough JSON to read back the flat one-line objects the harness
+// and the tools print.
+
+#include <stdlib.h>
+
+#include <string>
+
+inline size_t _json_value_pos(const std::string &line, const char *key) {
+    std::string k = std::string("\"") + key + "\"";
+    size_t pos = line.find(k);
+    if (pos == std::string::npos) return pos;
+    pos = line.find(':', pos + k.size());
+    if (pos == std::string::npos) return pos;
+    return line.find_first_not_of(" \t", pos + 1);
+}
+
+inline double json_number(const std::string &line, const char *key, double fallback) {
+    size_t pos = _json_value_pos(line, key);
+    if (pos == std::string::npos) return fallback;
+    const char *start = line.c_str() + pos;
+    char *end;
+    double v = strtod(start, &end);
+    return end == start ? fallback : v;
+}
+
+inline std::string json_string(const std::string &line, const char *key, const std::string &fallback) {
+    size_t pos = _json_value_pos(line, key);
+    if (pos == std::string::npos || line[pos] != '"') return fallback;
+    size_t end = line.find('"', pos + 1);
+    if (end == std::string::npos) return fallback;
+    return line.substr(pos + 1, end - pos - 1);
+}
+
+#endif
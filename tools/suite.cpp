@@ -0,0 +1,300 @@
+// Runs the pathological-schedule suite described by old/cases.txt (see
+// the suite target in the Makefile).
+//
+//   suite [-d dir] [-o history.jsonl] [-l label] [-t] [cases.txt]
+//
+// Every case runs as its own process under its time and memory budget
+// and ends up as ok, error, segfault, timeout, oom or build_failed. One
+// record per case, tagged with the label of the Halide build under test,
+// is appended to the history file. Each result is then compared with the
+// case's previous record (or its expected outcome the first time round)
+// and flagged when a pathological case became fast (FIXED), a fast case
+// became pathological (REGRESSED), or an ok case got much slower, faster
+// or hungrier. The exit status is 1 if anything regressed.
+//
+// With -t nothing is run; instead the history is printed as one row per
+// case and one column per label, oldest first.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+struct Case {
+    string name, expect;
+    double time_budget, mem_budget_mb;
+};
+
+struct Record {
+    string name, label, date, status;
+    double wall, time, peak_mb;
+};
+
+static vector<Case> read_cases(const char *path) {
+    vector<Case> cases;
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "can't read %s\n", path);
+        exit(1);
+    }
+    string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        std::istringstream fields(line);
+        Case c;
+        if (fields >> c.name >> c.expect >> c.time_budget >> c.mem_budget_mb) {
+            cases.push_back(c);
+        }
+    }
+    return cases;
+}
+
+static vector<Record> read_history(const string &path) {
+    vector<Record> history;
+    std::ifstream in(path.c_str());
+    string line;
+    while (std::getline(in, line)) {
+        Record r;
+        r.name = json_string(line, "case", "");
+        if (r.name.empty()) continue;
+        r.label = json_string(line, "label", "");
+        r.date = json_string(line, "date", "");
+        r.status = json_string(line, "status", "");
+        r.wall = json_number(line, "wall", -1);
+        r.time = json_number(line, "time", -1);
+        r.peak_mb = json_number(line, "peak_mb", -1);
+        history.push_back(r);
+    }
+    return history;
+}
+
+static void append_history(const string &path, const Record &r) {
+    FILE *f = fopen(path.c_str(), "a");
+    if (!f) {
+        perror(path.c_str());
+        exit(1);
+    }
+    fprintf(f, "{\"case\": \"%s\", \"label\": \"%s\", \"date\": \"%s\", \"status\": \"%s\", "
+            "\"wall\": %.3f, \"time\": %.10f, \"peak_mb\": %.1f}\n",
+            r.name.c_str(), r.label.c_str(), r.date.c_str(), r.status.c_str(),
+            r.wall, r.time, r.peak_mb);
+    fclose(f);
+}
+
+static double now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// Resident set of a running process in MB, from /proc
+static double rss_mb(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    double kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %lf", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb / 1024;
+}
+
+static Record run_case(const Case &c, const string &dir) {
+    Record r;
+    r.name = c.name;
+    r.wall = 0;
+    r.time = -1;
+    r.peak_mb = 0;
+
+    string exe = dir + "/" + c.name + ".exe";
+    string out = dir + "/" + c.name + ".out";
+    string log = dir + "/" + c.name + ".log";
+    if (access(exe.c_str(), X_OK) != 0) {
+        r.status = "build_failed";
+        return r;
+    }
+
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd_out = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int fd_log = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(fd_out, 1);
+        dup2(fd_log, 2);
+        execl(exe.c_str(), exe.c_str(), (char *)NULL);
+        _exit(127);
+    }
+
+    // Poll until the case exits or blows one of its budgets
+    const char *killed_for = NULL;
+    int status = 0;
+    rusage ru;
+    while (wait4(pid, &status, WNOHANG, &ru) == 0) {
+        if (!killed_for) {
+            if (now() - start > c.time_budget) {
+                killed_for = "timeout";
+            } else if (rss_mb(pid) > c.mem_budget_mb) {
+                killed_for = "oom";
+            }
+            if (killed_for) kill(pid, SIGKILL);
+        }
+        usleep(10000);
+    }
+    r.wall = now() - start;
+    r.peak_mb = ru.ru_maxrss / 1024.0;
+
+    if (killed_for) {
+        r.status = killed_for;
+    } else if (WIFEXITED(status)) {
+        r.status = WEXITSTATUS(status) == 0 ? "ok" : "error";
+    } else {
+        int sig = WTERMSIG(status);
+        if (sig == SIGSEGV || sig == SIGBUS) r.status = "segfault";
+        else if (sig == SIGALRM) r.status = "timeout";   // the stub's own AUTOTUNE_LIMIT
+        else if (sig == SIGKILL) r.status = "oom";       // nobody else kills cases: the OOM killer
+        else r.status = "error";
+    }
+
+    std::ifstream result(out.c_str());
+    string line;
+    if (std::getline(result, line)) r.time = json_number(line, "time", -1);
+    return r;
+}
+
+// Compare r with the reference outcome of the same case
+static string flag(const Record &r, const Record *prev, const Case &c) {
+    string prev_status = prev ? prev->status : c.expect;
+    bool was_bad = prev_status != "ok", is_bad = r.status != "ok";
+    if (was_bad && !is_bad) return "FIXED";
+    if (!was_bad && is_bad) return "REGRESSED";
+    if (was_bad) return prev_status == r.status ? "" : "changed (was " + prev_status + ")";
+    if (!prev) return "";
+
+    // ok both times: look at the trend
+    char buf[64];
+    double t0 = prev->time > 0 ? prev->time : prev->wall;
+    double t1 = r.time > 0 ? r.time : r.wall;
+    if (t0 > 0 && t1 > 1.25 * t0) {
+        snprintf(buf, sizeof(buf), "slower x%.2f", t1 / t0);
+        return buf;
+    }
+    if (t0 > 0 && t1 < 0.8 * t0) {
+        snprintf(buf, sizeof(buf), "faster x%.2f", t0 / t1);
+        return buf;
+    }
+    if (prev->peak_mb > 0 && r.peak_mb > 1.25 * prev->peak_mb) {
+        snprintf(buf, sizeof(buf), "memory x%.2f", r.peak_mb / prev->peak_mb);
+        return buf;
+    }
+    return "";
+}
+
+static void print_trend(const vector<Case> &cases, const vector<Record> &history) {
+    vector<string> labels;
+    map<string, map<string, const Record *> > cell;
+    for (size_t i = 0; i < history.size(); i++) {
+        const Record &r = history[i];
+        if (std::find(labels.begin(), labels.end(), r.label) == labels.end()) {
+            labels.push_back(r.label);
+        }
+        cell[r.name][r.label] = &r;
+    }
+    printf("%-42s", "case");
+    for (size_t j = 0; j < labels.size(); j++) printf(" %20s", labels[j].c_str());
+    printf("\n");
+    for (size_t i = 0; i < cases.size(); i++) {
+        printf("%-42s", cases[i].name.c_str());
+        for (size_t j = 0; j < labels.size(); j++) {
+            const Record *r = cell[cases[i].name][labels[j]];
+            char buf[64] = "-";
+            if (r && r->status == "ok") {
+                snprintf(buf, sizeof(buf), "%.3fs/%.0fMB", r->time > 0 ? r->time : r->wall, r->peak_mb);
+            } else if (r) {
+                snprintf(buf, sizeof(buf), "%s", r->status.c_str());
+            }
+            printf(" %20s", buf);
+        }
+        printf("\n");
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: suite [-d dir] [-o history.jsonl] [-l label] [-t] [cases.txt]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    string dir = "old", history_path = "suite-history.jsonl", label = "unknown";
+    bool trend_only = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:o:l:t")) != -1) {
+        switch (opt) {
+        case 'd': dir = optarg; break;
+        case 'o': history_path = optarg; break;
+        case 'l': label = optarg; break;
+        case 't': trend_only = true; break;
+        default: usage();
+        }
+    }
+    if (argc - optind > 1) usage();
+    string manifest = optind < argc ? argv[optind] : dir + "/cases.txt";
+
+    vector<Case> cases = read_cases(manifest.c_str());
+    vector<Record> history = read_history(history_path);
+    if (trend_only) {
+        print_trend(cases, history);
+        return 0;
+    }
+
+    map<string, Record> previous;
+    for (size_t i = 0; i < history.size(); i++) previous[history[i].name] = history[i];
+
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&t));
+
+    int fixed = 0, regressed = 0, bad = 0;
+    printf("%-42s %-12s %9s %12s %9s  %s\n", "case", "status", "wall(s)", "time(s)", "peak(MB)", "");
+    for (size_t i = 0; i < cases.size(); i++) {
+        Record r = run_case(cases[i], dir);
+        r.label = label;
+        r.date = date;
+        std::map<string, Record>::iterator prev = previous.find(r.name);
+        string note = flag(r, prev == previous.end() ? NULL : &prev->second, cases[i]);
+        append_history(history_path, r);
+
+        if (note == "FIXED") fixed++;
+        if (note == "REGRESSED") regressed++;
+        if (r.status != "ok") bad++;
+        printf("%-42s %-12s %9.2f %12.6f %9.1f  %s\n", r.name.c_str(), r.status.c_str(),
+               r.wall, r.time, r.peak_mb, note.c_str());
+        fflush(stdout);
+    }
+    printf("%d cases, %d pathological, %d fixed, %d regressed\n",
+           (int)cases.size(), bad, fixed, regressed);
+    return regressed ? 1 : 0;
+}